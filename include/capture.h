@@ -0,0 +1,70 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+
+// records what a rom draws, one frame at a time, without a window
+// frames get packed to 1bpp and queued; a worker thread does the encoding so
+// the emulator only ever pays for a 256 byte copy
+
+enum CaptureFormat {
+  CAPTURE_RAW, // one file; keyframe then per-row deltas, see capture.cpp
+  CAPTURE_PNG, // one 1-bit grayscale png per frame: <path>_000000.png
+  CAPTURE_Y4M  // one file; 8-bit mono y4m video at 60fps
+};
+
+typedef std::array<std::uint8_t, VIDEO_PACKED_SIZE> PackedFrame;
+
+class Capture {
+private:
+  CaptureFormat format;
+  std::string path;
+  std::FILE *file = nullptr;
+
+  // bounded ring of packed frames; Push() waits when it's full
+  std::vector<PackedFrame> ring;
+  std::size_t head = 0;
+  std::size_t count = 0;
+  bool done = false;
+  std::mutex lock;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+
+  std::thread worker;
+
+  // encoder state, only touched by the worker
+  PackedFrame previous = {};
+  unsigned long encoded = 0;
+  std::vector<std::uint8_t> scratch;
+
+  void Run();
+  void Encode(const PackedFrame &frame);
+  void WriteRaw(const PackedFrame &frame);
+  void WritePNG(const PackedFrame &frame);
+  void WriteY4M(const PackedFrame &frame);
+
+public:
+  Capture(CaptureFormat format, const char *path, std::size_t depth = 64);
+  ~Capture();
+
+  bool IsOpen() const;
+
+  // snapshot core.video into the queue
+  void Push(const CHIP8 &core);
+
+  // wait for the queue to drain and close the output
+  void Finish();
+};
+
+bool ParseCaptureFormat(const char *name, CaptureFormat &format);
+
+#endif
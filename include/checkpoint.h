@@ -0,0 +1,19 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <vector>
+
+// expected display hash at a given frame of a headless run
+// stored as text, one "<frame> <hash in hex>" per line, '#' starts a comment
+// a rom's checkpoints live next to it as <rom>.chk
+
+struct Checkpoint {
+  unsigned long frame;
+  std::uint64_t hash;
+};
+
+bool LoadCheckpoints(const char *filename, std::vector<Checkpoint> &out);
+bool SaveCheckpoints(const char *filename, const std::vector<Checkpoint> &in);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+/* libchip8: plain C interface to the core for hosting it from other
+ * languages and processes. everything here is part of the stable ABI; the
+ * CHIP8 class behind it is not.
+ *
+ * calls are meant to be batched; run thousands of cycles per call so the cost
+ * of crossing the boundary disappears. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef CHIP8_BUILDING_LIB
+#define CHIP8_API __declspec(dllexport)
+#else
+#define CHIP8_API __declspec(dllimport)
+#endif
+#else
+#define CHIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_VIDEO_WIDTH 64
+#define CHIP8_VIDEO_HEIGHT 32
+
+typedef struct chip8 chip8;
+
+/* NULL if out of memory */
+CHIP8_API chip8 *chip8_create(void);
+CHIP8_API void chip8_destroy(chip8 *emu);
+
+/* resets the instance to power-on state (memory, registers, display, keys,
+ * fault) and copies the rom in at 0x200; returns 0, or -1 if it doesn't fit,
+ * in which case the instance is left untouched */
+CHIP8_API int chip8_load_rom(chip8 *emu, const uint8_t *data, size_t size);
+
+/* run up to n instructions, or n frames' worth; returns how many actually
+ * ran, which is less than asked only if the core faulted */
+CHIP8_API unsigned long chip8_run_cycles(chip8 *emu, unsigned long n);
+CHIP8_API unsigned long chip8_run_frames(chip8 *emu, unsigned long n);
+
+/* CHIP8_VIDEO_WIDTH * CHIP8_VIDEO_HEIGHT pixels, 0x00000000 or 0xFFFFFFFF,
+ * row major. points into the instance; valid until chip8_destroy */
+CHIP8_API const uint32_t *chip8_framebuffer(const chip8 *emu);
+
+/* bit n set means key n is held */
+CHIP8_API void chip8_set_keys(chip8 *emu, uint16_t mask);
+
+/* what chip8_fault returns */
+#define CHIP8_FAULT_NONE 0
+#define CHIP8_FAULT_PC 1              /* pc ran off the end of memory */
+#define CHIP8_FAULT_MEMORY 2          /* I + offset past end of memory */
+#define CHIP8_FAULT_STACK_OVERFLOW 3  /* CALL with the stack full */
+#define CHIP8_FAULT_STACK_UNDERFLOW 4 /* RET with the stack empty */
+#define CHIP8_FAULT_KEYPAD 5          /* Ex9E/ExA1 with Vx > 0xF */
+
+/* CHIP8_FAULT_NONE while running, otherwise one of CHIP8_FAULT_*; a faulted
+ * instance stays put until the next chip8_load_rom */
+CHIP8_API int chip8_fault(const chip8 *emu);
+/* "unknown" for anything that isn't one of CHIP8_FAULT_* */
+CHIP8_API const char *chip8_fault_name(int fault);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
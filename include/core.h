@@ -6,13 +6,31 @@
 #include <cstring>
 #include <random>
 
-
+// what the core does when a rom indexes past memory, stack, keypad or video
+// pick at build time with -DCHIP8_BOUNDS_POLICY=...
+//   UNCHECKED: raw array access, fastest, a bad rom is undefined behavior
+//   WRAP: indices are masked back into range, like the address bus would
+//   TRAP: the access is refused, a Fault is recorded and the core halts
+#define CHIP8_BOUNDS_UNCHECKED 0
+#define CHIP8_BOUNDS_WRAP 1
+#define CHIP8_BOUNDS_TRAP 2
+
+#ifndef CHIP8_BOUNDS_POLICY
+#define CHIP8_BOUNDS_POLICY CHIP8_BOUNDS_TRAP
+#endif
 
 const unsigned int START_ADDRESS = 0x200;
 const unsigned int VIDEO_WIDTH = 64;
 const unsigned int VIDEO_HEIGHT = 32;
 const unsigned int FONTSET_SIZE = 80;
 const unsigned int FONTSET_START_ADDRESS = 0x50;
+const unsigned int VIDEO_PACKED_SIZE = VIDEO_WIDTH * VIDEO_HEIGHT / 8;
+const unsigned int MEMORY_SIZE = 4096;
+const unsigned int MEMORY_PAGE_SIZE = 256;
+const unsigned int MEMORY_PAGES = MEMORY_SIZE / MEMORY_PAGE_SIZE;
+
+// instructions we count as one 60hz frame when running without a window
+const unsigned int CYCLES_PER_FRAME = 10;
 
 // 16 chars represented by 5 rows each; rows are like scanlines encoded as hex
 // values so we need 16 characters * 5 bytes = 80 bytes array
@@ -36,10 +54,31 @@ const std::uint8_t fontset[FONTSET_SIZE] = {
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+// numbering is part of the libchip8 abi (CHIP8_FAULT_* in chip8.h); append only
+enum FaultType {
+  FAULT_NONE,
+  FAULT_PC,              // pc ran off the end of memory
+  FAULT_MEMORY,          // I + offset past end of memory
+  FAULT_STACK_OVERFLOW,  // CALL with 16 return addresses already pushed
+  FAULT_STACK_UNDERFLOW, // RET with nothing pushed
+  FAULT_KEYPAD           // Ex9E/ExA1 with Vx > 0xF
+};
+
+// first out of bounds access a core made; stays put until cleared
+struct Fault {
+  FaultType type;
+  std::uint16_t pc;      // address of the faulting instruction
+  std::uint16_t opcode;
+  std::uint32_t address; // the offending index (memory addr, sp, key); I can
+                         // wrap to 0xFFFF, so I + offset needs more than 16 bits
+};
+
+const char *FaultName(FaultType type);
+
 class CHIP8 {
 public:
   // u = unsigned, n_t = integer bitwidth
-  std::uint8_t memory[4096] = {0};
+  std::uint8_t memory[MEMORY_SIZE] = {0};
   std::uint8_t registers[16] = {0};
   std::uint16_t index = {0};
   std::uint16_t pc = {0};
@@ -51,13 +90,38 @@ public:
   std::uint32_t video[64 * 32] = {0};
   std::uint16_t opcode;
 
+  // one bit per memory page written to by the rom; lets snapshots restore
+  // only what changed
+  std::uint16_t dirtyPages = {0};
+
+  // display hash cache; 00E0/Dxyn mark the rows they touch and VideoHash()
+  // repacks just those; anything writing video directly should set all bits
+  std::uint32_t dirtyRows = {0xFFFFFFFFu};
+  std::uint8_t packedVideo[VIDEO_PACKED_SIZE] = {0};
+  std::uint64_t videoHash = {0};
+
+  // only ever set with CHIP8_BOUNDS_TRAP; Cycle() does nothing while set
+  Fault fault = {FAULT_NONE, 0, 0, 0};
+
+  // opcodes that hit OP_NULL; not a fault, plenty of roms have stray 0nnn
+  // SYS calls that real interpreters ignored too
+  unsigned long unknownOpcodes = {0};
+  std::uint16_t lastUnknownOpcode = {0};
+
+  // optional hook, called once when a fault is recorded
+  typedef void (*FaultHandler)(CHIP8 &core, const Fault &fault, void *user);
+  FaultHandler faultHandler = nullptr;
+  void *faultUser = nullptr;
+
   typedef void (CHIP8::*CHIP8Func)();
 
+  // sized to everything the masked opcode bits can index, unused slots are
+  // OP_NULL
   CHIP8Func table[0xF + 1u] = {0};
-  CHIP8Func table0[0xE + 1u] = {0};
-  CHIP8Func table8[0xE + 1u] = {0};
-  CHIP8Func tableE[0xE + 1u] = {0};
-  CHIP8Func tableF[0x65 + 1u] = {0};
+  CHIP8Func table0[0xF + 1u] = {0};
+  CHIP8Func table8[0xF + 1u] = {0};
+  CHIP8Func tableE[0xF + 1u] = {0};
+  CHIP8Func tableF[0xFF + 1u] = {0};
 
   std::default_random_engine randGen;
   std::uniform_int_distribution<uint8_t> randByte;
@@ -65,6 +129,13 @@ public:
   CHIP8();
 
   void LoadROM(const char *filename);
+  void LoadROM(const std::uint8_t *data, std::size_t size);
+
+  // display as 1 bit per pixel, msb first, 8 bytes per row
+  void PackVideo(std::uint8_t *out) const;
+
+  // 64 bit hash of the packed display; cheap when nothing was drawn
+  std::uint64_t VideoHash();
 
   void OP_00E0();
   void OP_00EE();
@@ -110,6 +181,19 @@ public:
   void TableF();
 
   void Cycle();
+  void ClearFault();
+
+private:
+  // every rom-controlled index goes through these; see CHIP8_BOUNDS_POLICY
+  std::uint8_t &Mem(unsigned int addr);
+  void Push(std::uint16_t addr);
+  std::uint16_t Pop();
+  std::uint8_t Key(unsigned int key);
+  std::uint32_t *Pixel(unsigned int x, unsigned int y);
+  void Trap(FaultType type, std::uint16_t where, std::uint32_t address);
+
+  // trapped writes land here so handlers never need an early out
+  std::uint8_t scratch = {0};
 };
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+// picks how many instructions to run per 60hz frame
+// measures how long each frame's work (emulate + draw) took on this host:
+// frames that blow the budget back the rate off hard, frames with plenty of
+// room creep it back up, always inside the rom's [min, max]
+// fast forward / slow motion scale the rate and both bounds
+
+const float FRAME_BUDGET_MS = 1000.0f / 60.0f;
+
+class Governor {
+private:
+  float minCycles;
+  float maxCycles;
+  float rate;
+  float speed = 1.0f;
+
+  unsigned long frames = 0;
+  unsigned long dropped = 0;
+
+  float Low() const;
+  float High() const;
+
+public:
+  Governor(unsigned int minCycles, unsigned int maxCycles);
+
+  // instructions to run this frame
+  unsigned int Cycles() const;
+
+  // report how long this frame's work took
+  void FrameDone(float workMs);
+
+  // 1 is normal; takes effect from the next frame
+  void SetSpeed(float newSpeed);
+  float Speed() const;
+
+  unsigned long Frames() const;
+  unsigned long Dropped() const;
+};
+
+#endif
@@ -8,19 +8,49 @@
 #include <SDL_render.h>
 #include <SDL_video.h>
 #include <cstdint>
+#include <vector>
+
+// GPU lets SDL scale a texture; the CPU modes skip the renderer and expand
+// pixels straight into the window surface, which is much faster than SDL's
+// software renderer on hosts without a GPU
+// CRT is CPU plus phosphor decay; pixels fade out over a few frames instead of
+// vanishing, which hides most of the XOR sprite flicker
+enum RenderMode { RENDER_GPU, RENDER_CPU, RENDER_CRT };
+
+bool ParseRenderMode(const char *name, RenderMode &mode);
+
+// emulator controls outside the chip-8 keypad; both are held, not toggled
+// tab: fast forward, space: slow motion
+struct Hotkeys {
+  bool fastForward = false;
+  bool slowMotion = false;
+};
 
 class Platform {
 private:
   SDL_Window *window;
-  SDL_Renderer *renderer;
-  SDL_Texture *texture;
+  SDL_Renderer *renderer = nullptr;
+  SDL_Texture *texture = nullptr;
+
+  // cpu path; sized once in the constructor, reused every frame
+  RenderMode mode;
+  int textureWidth;
+  int textureHeight;
+  std::vector<std::uint8_t> phosphor; // per source pixel brightness 0-255
+  std::vector<std::uint32_t> palette; // brightness -> surface pixel value
+  std::uint32_t paletteFormat = 0;
+  bool surfaceReported = false; // unusable surface depth, said so once
+
+  void UpdateSurface(const std::uint32_t *buffer, int pitch);
 
 public:
-  Platform(const char *title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+  Platform(const char *title, int windowWidth, int windowHeight, int textureWidth, int textureHeight,
+           RenderMode mode = RENDER_GPU);
   ~Platform();
 
   void Update(const void *buffer, int pitch);
-  bool ProcessInput(std::uint8_t *keys);
+  void SetTitle(const char *title);
+  bool ProcessInput(std::uint8_t *keys, Hotkeys *hotkeys = nullptr);
 };
 
 #endif
@@ -0,0 +1,89 @@
+#ifndef RECOMP_H
+#define RECOMP_H
+
+#include "core.h"
+
+// support for roms translated ahead of time by chip8-recomp
+// the generated function runs the rom as a switch-on-pc state machine over the
+// same CHIP8 state, calling the same opcode handlers the interpreter does; it
+// hands control back whenever it can't know statically where to go
+
+enum RecompExit {
+  RECOMP_BUDGET,    // used up every cycle it was given
+  RECOMP_INTERPRET, // pc isn't translated code; interpret one cycle, re-enter
+  RECOMP_MODIFIED,  // rom wrote over its own code; interpret from now on
+  RECOMP_FAULT      // core.fault is set
+};
+
+// budget is cycles left; the function counts it down as it goes
+typedef RecompExit (*RecompFunc)(CHIP8 &core, unsigned long &budget);
+
+// what chip8-recomp emits for a rom: the function plus where its code came from
+struct RecompProgram {
+  RecompFunc func;
+  const std::uint8_t *code; // one bit per translated byte of memory
+  std::uint16_t codePages;  // one bit per 256 byte page holding any of them
+};
+
+// run up to budget cycles through program, falling back to core.Cycle() where
+// it can't go; modified latches once the rom patches its own code
+// returns cycles actually run
+unsigned long RecompRun(CHIP8 &core, const RecompProgram &program,
+                        unsigned long budget, bool &modified);
+
+// run rom through program and through the interpreter side by side, feeding
+// both the same fixed key presses and comparing state every so often; prints
+// the first difference and returns false
+bool RecompVerify(const char *romFilename, const RecompProgram &program,
+                  unsigned long cycles);
+
+// does a store to [start, start + len) land on translated code? addresses wrap
+// the same way the core's page marking does
+inline bool RecompTouchesCode(const std::uint8_t *code, unsigned int start,
+                              unsigned int len) {
+  for (unsigned int i = 0; i < len; ++i) {
+    unsigned int addr = (start + i) & (MEMORY_SIZE - 1);
+    if (code[addr >> 3u] & (1u << (addr & 7u))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// building blocks for generated code
+
+// one instruction: pay for it, then look exactly like Cycle() after its fetch
+#define RECOMP_STEP(addr, op)                                                  \
+  if (budget == 0) {                                                           \
+    core.pc = (addr);                                                          \
+    return RECOMP_BUDGET;                                                      \
+  }                                                                            \
+  --budget;                                                                    \
+  core.opcode = (op);                                                          \
+  core.pc = (addr) + 2;
+
+#define RECOMP_TIMERS()                                                        \
+  if (core.delayTimer > 0) {                                                   \
+    --core.delayTimer;                                                         \
+  }                                                                            \
+  if (core.soundTimer > 0) {                                                   \
+    --core.soundTimer;                                                         \
+  }
+
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+#define RECOMP_CHECK_FAULT()                                                   \
+  if (core.fault.type != FAULT_NONE) {                                         \
+    return RECOMP_FAULT;                                                       \
+  }
+#else
+#define RECOMP_CHECK_FAULT()
+#endif
+
+// Fx33/Fx55 wrote [core.index, core.index + len); bail if any of it was code
+// code is the bitmap the generated file defines next to the function
+#define RECOMP_CHECK_WRITE(len)                                                \
+  if (RecompTouchesCode(code, core.index, (len))) {                            \
+    return RECOMP_MODIFIED;                                                    \
+  }
+
+#endif
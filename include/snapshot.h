@@ -0,0 +1,21 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+
+#include "core.h"
+
+// saved copy of a core we can roll back to over and over (fuzzing, replays)
+// memory is restored page by page; only pages the core marked dirty since the
+// last save/restore are copied back, everything else is small enough to copy
+
+class Snapshot {
+private:
+  CHIP8 saved;
+
+public:
+  void Save(CHIP8 &core);
+  void Restore(CHIP8 &core) const;
+};
+
+#endif
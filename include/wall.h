@@ -0,0 +1,50 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "core.h"
+
+// shared memory between emulator worker processes and one viewer
+// each worker owns a slot: it publishes its packed display there every frame
+// and reads the keys the viewer writes back. slots are seqlocked; the worker
+// never waits on the viewer and a reader just retries (or gives up) on a torn
+// read, so a worker dying mid-write can't wedge the display
+
+const unsigned int WALL_MAX_SLOTS = 64;
+const unsigned int WALL_FRAME_WORDS = VIDEO_PACKED_SIZE / 8;
+
+// these atomics live in memory shared between processes; that's only sound if
+// they're lock-free (a lock would be process-local)
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::uint16_t>::is_always_lock_free,
+              "wall slots need lock-free atomics");
+
+struct WallSlot {
+  std::atomic<std::uint32_t> sequence; // odd while the worker is writing
+  std::atomic<std::uint16_t> keys;     // written by the viewer, bit n = key n
+  std::atomic<std::uint64_t> frame[WALL_FRAME_WORDS];
+};
+
+struct WallSegment {
+  WallSlot slots[WALL_MAX_SLOTS];
+};
+
+// maps /<name>, creating it if it doesn't exist yet so start order doesn't
+// matter; nullptr on failure
+WallSegment *WallOpen(const char *name);
+void WallClose(WallSegment *segment);
+
+// unlinks /<name>; for whoever launches the wall, once every worker and the
+// viewer are gone. neither of them calls it, so either can restart
+void WallRemove(const char *name);
+
+void WallPublish(WallSlot &slot, const std::uint8_t *packed);
+
+// false if the slot kept changing under us; packed is left unspecified
+bool WallRead(const WallSlot &slot, std::uint8_t *packed,
+              std::uint32_t &sequence);
+
+#endif
@@ -0,0 +1,75 @@
+#include <new>
+
+#include "chip8.h"
+#include "core.h"
+
+// the opaque handle is just the core; keeps the class out of the abi
+struct chip8 {
+  CHIP8 core;
+};
+
+static_assert(CHIP8_VIDEO_WIDTH == VIDEO_WIDTH, "abi width out of sync");
+static_assert(CHIP8_VIDEO_HEIGHT == VIDEO_HEIGHT, "abi height out of sync");
+
+// fault codes are abi; FaultType can't be renumbered without breaking callers
+static_assert(CHIP8_FAULT_NONE == FAULT_NONE, "abi fault out of sync");
+static_assert(CHIP8_FAULT_PC == FAULT_PC, "abi fault out of sync");
+static_assert(CHIP8_FAULT_MEMORY == FAULT_MEMORY, "abi fault out of sync");
+static_assert(CHIP8_FAULT_STACK_OVERFLOW == FAULT_STACK_OVERFLOW,
+              "abi fault out of sync");
+static_assert(CHIP8_FAULT_STACK_UNDERFLOW == FAULT_STACK_UNDERFLOW,
+              "abi fault out of sync");
+static_assert(CHIP8_FAULT_KEYPAD == FAULT_KEYPAD, "abi fault out of sync");
+
+chip8 *chip8_create(void) { return new (std::nothrow) chip8; }
+
+void chip8_destroy(chip8 *emu) { delete emu; }
+
+int chip8_load_rom(chip8 *emu, const uint8_t *data, size_t size) {
+  if (size > MEMORY_SIZE - START_ADDRESS) {
+    return -1;
+  }
+
+  // a fresh core, so a previous run's pc, stack, display or fault can't leak
+  // into this one
+  emu->core = CHIP8();
+  emu->core.LoadROM(data, size);
+  return 0;
+}
+
+unsigned long chip8_run_cycles(chip8 *emu, unsigned long n) {
+  CHIP8 &core = emu->core;
+
+  for (unsigned long i = 0; i < n; ++i) {
+    core.Cycle();
+
+    // a faulted core won't move again; no point spinning
+    if (core.fault.type != FAULT_NONE) {
+      return i;
+    }
+  }
+
+  return n;
+}
+
+unsigned long chip8_run_frames(chip8 *emu, unsigned long n) {
+  return chip8_run_cycles(emu, n * CYCLES_PER_FRAME) / CYCLES_PER_FRAME;
+}
+
+const uint32_t *chip8_framebuffer(const chip8 *emu) { return emu->core.video; }
+
+void chip8_set_keys(chip8 *emu, uint16_t mask) {
+  for (unsigned int i = 0; i < 16; ++i) {
+    emu->core.keypad[i] = (mask >> i) & 1u;
+  }
+}
+
+int chip8_fault(const chip8 *emu) { return emu->core.fault.type; }
+
+const char *chip8_fault_name(int fault) {
+  // anything outside the enum's range can't even be cast to it
+  if (fault < CHIP8_FAULT_NONE || fault > CHIP8_FAULT_KEYPAD) {
+    return "unknown";
+  }
+  return FaultName(static_cast<FaultType>(fault));
+}
@@ -0,0 +1,273 @@
+#include <cstring>
+
+#include "capture.h"
+
+// raw format
+// header: "CH8R", width byte, height byte
+// then one record per frame, starting with a tag byte:
+//   0 - same as the previous frame, nothing follows
+//   1 - keyframe, all VIDEO_PACKED_SIZE bytes follow
+//   2 - delta, a 32 bit little endian mask of changed rows follows, then the
+//       8 packed bytes of each changed row top to bottom
+// most frames of most roms only touch a few rows, so this stays tiny
+
+const unsigned int PACKED_ROW_SIZE = VIDEO_WIDTH / 8;
+
+enum RawTag { RAW_REPEAT = 0, RAW_KEYFRAME = 1, RAW_DELTA = 2 };
+
+bool ParseCaptureFormat(const char *name, CaptureFormat &format) {
+  if (std::strcmp(name, "raw") == 0) {
+    format = CAPTURE_RAW;
+  } else if (std::strcmp(name, "png") == 0) {
+    format = CAPTURE_PNG;
+  } else if (std::strcmp(name, "y4m") == 0) {
+    format = CAPTURE_Y4M;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Capture::Capture(CaptureFormat format, const char *path, std::size_t depth)
+    : format(format), path(path), ring(depth ? depth : 1) {
+  // png writes a file per frame; the others stream into one
+  if (format != CAPTURE_PNG) {
+    file = std::fopen(path, "wb");
+    if (!file) {
+      return;
+    }
+  }
+
+  if (format == CAPTURE_RAW) {
+    const std::uint8_t header[6] = {'C', 'H', '8', 'R', VIDEO_WIDTH,
+                                    VIDEO_HEIGHT};
+    std::fwrite(header, 1, sizeof(header), file);
+  } else if (format == CAPTURE_Y4M) {
+    std::fprintf(file, "YUV4MPEG2 W%u H%u F60:1 Ip A1:1 Cmono\n", VIDEO_WIDTH,
+                 VIDEO_HEIGHT);
+  }
+
+  worker = std::thread(&Capture::Run, this);
+}
+
+Capture::~Capture() { Finish(); }
+
+bool Capture::IsOpen() const { return format == CAPTURE_PNG || file; }
+
+void Capture::Push(const CHIP8 &core) {
+  if (!worker.joinable()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> guard(lock);
+
+  // backpressure; if the encoder is this far behind, wait for it instead of
+  // growing without bound
+  notFull.wait(guard, [this] { return count < ring.size(); });
+
+  core.PackVideo(ring[(head + count) % ring.size()].data());
+  ++count;
+
+  guard.unlock();
+  notEmpty.notify_one();
+}
+
+void Capture::Finish() {
+  if (worker.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    notEmpty.notify_one();
+    worker.join();
+  }
+
+  if (file) {
+    std::fclose(file);
+    file = nullptr;
+  }
+}
+
+void Capture::Run() {
+  PackedFrame frame;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      notEmpty.wait(guard, [this] { return count > 0 || done; });
+
+      if (count == 0) {
+        return;
+      }
+
+      // copy out so the slot is free while we encode
+      frame = ring[head];
+      head = (head + 1) % ring.size();
+      --count;
+    }
+    notFull.notify_one();
+
+    Encode(frame);
+  }
+}
+
+void Capture::Encode(const PackedFrame &frame) {
+  switch (format) {
+  case CAPTURE_RAW:
+    WriteRaw(frame);
+    break;
+  case CAPTURE_PNG:
+    WritePNG(frame);
+    break;
+  case CAPTURE_Y4M:
+    WriteY4M(frame);
+    break;
+  }
+
+  previous = frame;
+  ++encoded;
+}
+
+void Capture::WriteRaw(const PackedFrame &frame) {
+  if (encoded == 0) {
+    std::fputc(RAW_KEYFRAME, file);
+    std::fwrite(frame.data(), 1, frame.size(), file);
+    return;
+  }
+
+  std::uint32_t changed = 0;
+  for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+    if (std::memcmp(&frame[row * PACKED_ROW_SIZE],
+                    &previous[row * PACKED_ROW_SIZE], PACKED_ROW_SIZE) != 0) {
+      changed |= 1u << row;
+    }
+  }
+
+  if (changed == 0) {
+    std::fputc(RAW_REPEAT, file);
+    return;
+  }
+
+  std::fputc(RAW_DELTA, file);
+  for (unsigned int i = 0; i < 4; ++i) {
+    std::fputc((changed >> (i * 8)) & 0xFFu, file);
+  }
+  for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+    if (changed & (1u << row)) {
+      std::fwrite(&frame[row * PACKED_ROW_SIZE], 1, PACKED_ROW_SIZE, file);
+    }
+  }
+}
+
+// png needs crc32 on every chunk and adler32 on the zlib stream
+
+static std::uint32_t Crc32(const std::uint8_t *data, std::size_t size,
+                           std::uint32_t crc = 0) {
+  // every capture has its own worker thread; a function-local static is built
+  // exactly once no matter how many of them get here first
+  static const std::array<std::uint32_t, 256> table = [] {
+    std::array<std::uint32_t, 256> entries;
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t c = i;
+      for (unsigned int k = 0; k < 8; ++k) {
+        c = (c & 1u) ? 0xEDB88320u ^ (c >> 1u) : c >> 1u;
+      }
+      entries[i] = c;
+    }
+    return entries;
+  }();
+
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8u);
+  }
+  return ~crc;
+}
+
+static std::uint32_t Adler32(const std::uint8_t *data, std::size_t size) {
+  std::uint32_t a = 1;
+  std::uint32_t b = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    a = (a + data[i]) % 65521u;
+    b = (b + a) % 65521u;
+  }
+  return (b << 16u) | a;
+}
+
+static void PutBE32(std::vector<std::uint8_t> &out, std::uint32_t value) {
+  out.push_back(value >> 24u);
+  out.push_back(value >> 16u);
+  out.push_back(value >> 8u);
+  out.push_back(value);
+}
+
+static void PutChunk(std::vector<std::uint8_t> &out, const char *type,
+                     const std::uint8_t *data, std::size_t size) {
+  PutBE32(out, size);
+  std::size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + size);
+  PutBE32(out, Crc32(&out[start], size + 4));
+}
+
+void Capture::WritePNG(const PackedFrame &frame) {
+  // our packed layout already is png's 1-bit grayscale scanline layout; each
+  // row just needs a filter byte (0, none) in front
+  const std::size_t rawSize = VIDEO_HEIGHT * (1 + PACKED_ROW_SIZE);
+  std::uint8_t raw[rawSize];
+  for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+    raw[row * (1 + PACKED_ROW_SIZE)] = 0;
+    std::memcpy(&raw[row * (1 + PACKED_ROW_SIZE) + 1],
+                &frame[row * PACKED_ROW_SIZE], PACKED_ROW_SIZE);
+  }
+
+  // 288 bytes isn't worth compressing; one stored deflate block
+  std::uint8_t zlib[2 + 5 + rawSize + 4];
+  zlib[0] = 0x78;
+  zlib[1] = 0x01;
+  zlib[2] = 0x01; // final block, stored
+  zlib[3] = rawSize & 0xFFu;
+  zlib[4] = rawSize >> 8u;
+  zlib[5] = ~rawSize & 0xFFu;
+  zlib[6] = (~rawSize >> 8u) & 0xFFu;
+  std::memcpy(&zlib[7], raw, rawSize);
+  std::uint32_t adler = Adler32(raw, rawSize);
+  zlib[7 + rawSize] = adler >> 24u;
+  zlib[8 + rawSize] = adler >> 16u;
+  zlib[9 + rawSize] = adler >> 8u;
+  zlib[10 + rawSize] = adler;
+
+  const std::uint8_t ihdr[13] = {0, 0, 0, VIDEO_WIDTH, 0, 0, 0, VIDEO_HEIGHT,
+                                 1, // bit depth
+                                 0, // grayscale
+                                 0, 0, 0};
+
+  static const std::uint8_t signature[8] = {0x89, 'P',  'N',  'G',
+                                            '\r', '\n', 0x1A, '\n'};
+
+  // reuse the same buffer every frame
+  scratch.clear();
+  scratch.insert(scratch.end(), signature, signature + 8);
+  PutChunk(scratch, "IHDR", ihdr, sizeof(ihdr));
+  PutChunk(scratch, "IDAT", zlib, sizeof(zlib));
+  PutChunk(scratch, "IEND", nullptr, 0);
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "_%06lu.png", encoded);
+  std::FILE *out = std::fopen((path + name).c_str(), "wb");
+  if (out) {
+    std::fwrite(scratch.data(), 1, scratch.size(), out);
+    std::fclose(out);
+  }
+}
+
+void Capture::WriteY4M(const PackedFrame &frame) {
+  // unpack back to a byte per pixel; that's all mono y4m is
+  scratch.resize(VIDEO_WIDTH * VIDEO_HEIGHT);
+  for (unsigned int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; ++i) {
+    scratch[i] = (frame[i / 8] & (0x80u >> (i % 8))) ? 0xFF : 0x00;
+  }
+
+  std::fputs("FRAME\n", file);
+  std::fwrite(scratch.data(), 1, scratch.size(), file);
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "checkpoint.h"
+
+bool LoadCheckpoints(const char *filename, std::vector<Checkpoint> &out) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  out.clear();
+
+  std::string line;
+  while (std::getline(file, line)) {
+    // strip comments, skip blank lines
+    line = line.substr(0, line.find('#'));
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    Checkpoint checkpoint;
+    if (!(fields >> checkpoint.frame >> std::hex >> checkpoint.hash)) {
+      return false;
+    }
+    out.push_back(checkpoint);
+  }
+
+  // runners walk these in order
+  std::sort(out.begin(), out.end(),
+            [](const Checkpoint &a, const Checkpoint &b) {
+              return a.frame < b.frame;
+            });
+  return true;
+}
+
+bool SaveCheckpoints(const char *filename, const std::vector<Checkpoint> &in) {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  file << "# frame hash\n";
+
+  char line[64];
+  for (const Checkpoint &checkpoint : in) {
+    std::snprintf(line, sizeof(line), "%lu %016llx\n", checkpoint.frame,
+                  static_cast<unsigned long long>(checkpoint.hash));
+    file << line;
+  }
+
+  return file.good();
+}
@@ -3,6 +3,117 @@
 
 #include "core.h"
 
+const char *FaultName(FaultType type) {
+  switch (type) {
+  case FAULT_NONE:
+    return "none";
+  case FAULT_PC:
+    return "pc out of memory";
+  case FAULT_MEMORY:
+    return "memory access out of bounds";
+  case FAULT_STACK_OVERFLOW:
+    return "stack overflow";
+  case FAULT_STACK_UNDERFLOW:
+    return "stack underflow";
+  case FAULT_KEYPAD:
+    return "keypad index out of bounds";
+  }
+  return "unknown";
+}
+
+// bounds policy
+// the #if's resolve at compile time so UNCHECKED is the plain array access
+
+std::uint8_t &CHIP8::Mem(unsigned int addr) {
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_WRAP
+  return memory[addr & (MEMORY_SIZE - 1)];
+#elif CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  if (addr >= MEMORY_SIZE) {
+    Trap(FAULT_MEMORY, pc - 2, addr);
+    return scratch;
+  }
+  return memory[addr];
+#else
+  return memory[addr];
+#endif
+}
+
+void CHIP8::Push(std::uint16_t addr) {
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_WRAP
+  stack[sp & 0xFu] = addr;
+  sp = (sp + 1) & 0xFu;
+#elif CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  if (sp >= 16) {
+    Trap(FAULT_STACK_OVERFLOW, pc - 2, sp);
+    return;
+  }
+  stack[sp] = addr;
+  ++sp;
+#else
+  stack[sp] = addr;
+  ++sp;
+#endif
+}
+
+std::uint16_t CHIP8::Pop() {
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_WRAP
+  sp = (sp - 1) & 0xFu;
+#elif CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  if (sp == 0) {
+    Trap(FAULT_STACK_UNDERFLOW, pc - 2, sp);
+    return pc;
+  }
+  --sp;
+#else
+  --sp;
+#endif
+  return stack[sp];
+}
+
+std::uint8_t CHIP8::Key(unsigned int key) {
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_WRAP
+  return keypad[key & 0xFu];
+#elif CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  if (key > 0xF) {
+    Trap(FAULT_KEYPAD, pc - 2, key);
+    return 0;
+  }
+  return keypad[key];
+#else
+  return keypad[key];
+#endif
+}
+
+std::uint32_t *CHIP8::Pixel(unsigned int x, unsigned int y) {
+  // sprites hanging off the edge aren't a rom bug; trap clips them like the
+  // original interpreter did instead of faulting
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_WRAP
+  return &video[(y % VIDEO_HEIGHT) * VIDEO_WIDTH + (x % VIDEO_WIDTH)];
+#elif CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  if (x >= VIDEO_WIDTH || y >= VIDEO_HEIGHT) {
+    return nullptr;
+  }
+  return &video[y * VIDEO_WIDTH + x];
+#else
+  return &video[y * VIDEO_WIDTH + x];
+#endif
+}
+
+void CHIP8::Trap(FaultType type, std::uint16_t where, std::uint32_t address) {
+  // keep the first fault; anything after it is fallout
+  if (fault.type != FAULT_NONE) {
+    return;
+  }
+
+  fault = {type, where, opcode, address};
+
+  if (faultHandler) {
+    faultHandler(*this, fault, faultUser);
+  }
+}
+
+void CHIP8::ClearFault() { fault = {FAULT_NONE, 0, 0, 0}; }
+
 void CHIP8::LoadROM(const char *filename) {
   // we need to load roms first to get our instructions
   // pass filename as const since we won't modify that string
@@ -20,30 +131,91 @@ void CHIP8::LoadROM(const char *filename) {
     file.read(buffer, size);
     file.close();
 
-    // load rom into chip8 memory!
-    for (long i = 0; i < size; ++i) {
-      memory[START_ADDRESS + i] = buffer[i];
-    }
+    LoadROM(reinterpret_cast<std::uint8_t *>(buffer), size);
 
     // free buffer
     delete[] buffer;
   }
 }
 
+void CHIP8::LoadROM(const std::uint8_t *data, std::size_t size) {
+  // anything past the end of memory just doesn't fit
+  if (size > MEMORY_SIZE - START_ADDRESS) {
+    size = MEMORY_SIZE - START_ADDRESS;
+  }
+
+  // load rom into chip8 memory!
+  std::memcpy(&memory[START_ADDRESS], data, size);
+}
+
+static std::uint8_t PackByte(const std::uint32_t *pixels) {
+  // pixels are either all 0 or all 1s; squeeze each one down to a bit
+  std::uint8_t byte = 0;
+  for (unsigned int bit = 0; bit < 8; ++bit) {
+    byte = (byte << 1u) | (pixels[bit] & 1u);
+  }
+  return byte;
+}
+
+void CHIP8::PackVideo(std::uint8_t *out) const {
+  for (unsigned int i = 0; i < VIDEO_PACKED_SIZE; ++i) {
+    out[i] = PackByte(&video[i * 8]);
+  }
+}
+
+std::uint64_t CHIP8::VideoHash() {
+  if (dirtyRows == 0) {
+    return videoHash;
+  }
+
+  // repack only the rows drawn to since last time
+  const unsigned int rowBytes = VIDEO_WIDTH / 8;
+  for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+    if (dirtyRows & (1u << row)) {
+      for (unsigned int i = row * rowBytes; i < (row + 1) * rowBytes; ++i) {
+        packedVideo[i] = PackByte(&video[i * 8]);
+      }
+    }
+  }
+  dirtyRows = 0;
+
+  // xxhash style: multiply-rotate each 8 byte word in, avalanche at the end
+  // a row is exactly one word
+  const std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+  const std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+  std::uint64_t hash = prime2 ^ VIDEO_PACKED_SIZE;
+
+  for (unsigned int i = 0; i < VIDEO_PACKED_SIZE; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, &packedVideo[i], 8);
+    hash ^= word * prime2;
+    hash = ((hash << 31u) | (hash >> 33u)) * prime1;
+  }
+
+  hash ^= hash >> 33u;
+  hash *= prime2;
+  hash ^= hash >> 29u;
+  hash *= 0x165667B19E3779F9ull;
+  hash ^= hash >> 32u;
+
+  videoHash = hash;
+  return videoHash;
+}
+
 // 00E0 - CLS
 void CHIP8::OP_00E0() {
   // set all pixels in display to 0
   // memset sets a given number of chars (bytes) in dest to what we specify
 
   memset(video, 0, sizeof(video));
+  dirtyRows = 0xFFFFFFFFu;
 }
 
 // 00EE - RET
 void CHIP8::OP_00EE() {
   // stack return
   // decrement stack pointer and set pc to instruction it points to now
-  --sp;
-  pc = stack[sp];
+  pc = Pop();
 }
 
 // 1nnn - JP addr
@@ -63,8 +235,7 @@ void CHIP8::OP_2nnn() {
   // pc += 2 when cycling; the pc we are pushing holds instruction after CALL
   // this "readies up" the next instruction after the subroutine
   std::uint16_t target_addr = opcode & 0x0FFFu;
-  stack[sp] = pc;
-  ++sp;
+  Push(pc);
   pc = target_addr;
 }
 
@@ -273,18 +444,17 @@ void CHIP8::OP_Dxyn() {
   registers[0xF] = 0;
 
   for (unsigned int row = 0; row < height; ++row) {
-    std::uint8_t spriteByte = memory[index + row];
+    std::uint8_t spriteByte = Mem(index + row);
 
     for (unsigned int col = 0; col < 8; ++col) {
       // get sprite pixel value by masking with the byte row; 1 if on, 0 if
       // off
       std::uint8_t spritePixel = spriteByte & (0x80u >> col);
 
-      // get corresponding screen pixel's address
-      std::uint32_t *screenPixel =
-          &video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+      // get corresponding screen pixel's address; null if clipped
+      std::uint32_t *screenPixel = Pixel(xPos + col, yPos + row);
 
-      if (spritePixel) {
+      if (spritePixel && screenPixel) {
         // if the sprite pixel is on and the screen pixel is also on, there is
         // collision!
         if (*screenPixel == 0xFFFFFFFF) {
@@ -294,6 +464,10 @@ void CHIP8::OP_Dxyn() {
         // since we get here if sprite pixel on, XOR with 0xFFFFFFFF
         // effectively does so with the pixel
         *screenPixel ^= 0xFFFFFFFF;
+
+        // mark the row the write actually landed in; unchecked sprites past
+        // the right edge spill into the next row, not their own
+        dirtyRows |= 1u << (((screenPixel - video) / VIDEO_WIDTH) % VIDEO_HEIGHT);
       }
     }
   }
@@ -305,7 +479,7 @@ void CHIP8::OP_Ex9E() {
   std::uint8_t Vx = (opcode & 0x0F00u) >> 8u;
   std::uint8_t key = registers[Vx];
 
-  if (keypad[key]) {
+  if (Key(key)) {
     pc += 2;
   }
 }
@@ -316,7 +490,7 @@ void CHIP8::OP_ExA1() {
   std::uint8_t Vx = (opcode & 0x0F00u) >> 8u;
   std::uint8_t key = registers[Vx];
 
-  if (!keypad[key]) {
+  if (!Key(key)) {
     pc += 2;
   }
 }
@@ -393,16 +567,19 @@ void CHIP8::OP_Fx33() {
   std::uint8_t Vx = (opcode & 0x0F00u) >> 8u;
   std::uint8_t value = registers[Vx];
 
+  dirtyPages |= 1u << ((index >> 8u) & 0xFu);
+  dirtyPages |= 1u << (((index + 2) >> 8u) & 0xFu);
+
   // ones
-  memory[index + 2] = value % 10;
+  Mem(index + 2) = value % 10;
   value /= 10;
 
   // tens
-  memory[index + 1] = value % 10;
+  Mem(index + 1) = value % 10;
   value /= 10;
 
   // hundreds
-  memory[index] = value % 10;
+  Mem(index) = value % 10;
 }
 
 // Fx55 - LD [I], Vx
@@ -410,8 +587,12 @@ void CHIP8::OP_Fx55() {
   // store registers V0 through Vx in memory starting at location I
   std::uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
+  // mark pages for snapshots; range is at most 16 bytes so 2 pages tops
+  dirtyPages |= 1u << ((index >> 8u) & 0xFu);
+  dirtyPages |= 1u << (((index + Vx) >> 8u) & 0xFu);
+
   for (std::uint8_t i = 0; i <= Vx; ++i) {
-    memory[index + i] = registers[i];
+    Mem(index + i) = registers[i];
   }
 }
 
@@ -422,7 +603,7 @@ void CHIP8::OP_Fx65() {
   std::uint8_t Vx = (opcode & 0x0F00u) >> 8u;
 
   for (std::uint8_t i = 0; i <= Vx; ++i) {
-    registers[i] = memory[index + i];
+    registers[i] = Mem(index + i);
   }
 }
 
@@ -436,7 +617,11 @@ void CHIP8::TableE() { ((*this).*(tableE[opcode & 0x000Fu]))(); }
 
 void CHIP8::TableF() { ((*this).*(tableF[opcode & 0x00FFu]))(); }
 
-void CHIP8::OP_NULL() { return; }
+void CHIP8::OP_NULL() {
+  // still a no-op, but keep count so headless runs can report it
+  ++unknownOpcodes;
+  lastUnknownOpcode = opcode;
+}
 
 // cpu cycling!
 
@@ -445,9 +630,21 @@ void CHIP8::Cycle() {
   // decodes the instruction
   // runs it!
 
+#if CHIP8_BOUNDS_POLICY == CHIP8_BOUNDS_TRAP
+  // a faulted core stays put until someone clears it
+  if (fault.type != FAULT_NONE) {
+    return;
+  }
+
+  if (pc > MEMORY_SIZE - 2) {
+    Trap(FAULT_PC, pc, pc);
+    return;
+  }
+#endif
+
   // fetch
   // remember opcode is 2bytes; stitch 2 halves together
-  opcode = (memory[pc] << 8u) | memory[pc + 1];
+  opcode = (Mem(pc) << 8u) | Mem(pc + 1);
 
   // move pc
   pc += 2;
@@ -497,7 +694,7 @@ CHIP8::CHIP8() {
   table[0xF] = &CHIP8::TableF;
 
   // init tables of 0, 8, E instructions with null ops
-  for (size_t i = 0; i <= 0xE; ++i) {
+  for (size_t i = 0; i <= 0xF; ++i) {
     table0[i] = &CHIP8::CHIP8::OP_NULL;
     table8[i] = &CHIP8::CHIP8::OP_NULL;
     tableE[i] = &CHIP8::CHIP8::OP_NULL;
@@ -523,7 +720,7 @@ CHIP8::CHIP8() {
   tableE[0xE] = &CHIP8::CHIP8::OP_Ex9E;
 
   // now initialize the F table
-  for (size_t i = 0; i <= 0x65; ++i) {
+  for (size_t i = 0; i <= 0xFF; ++i) {
     tableF[i] = &CHIP8::CHIP8::OP_NULL;
   }
 
@@ -0,0 +1,440 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "snapshot.h"
+
+// in-process rom fuzzer
+// every execution rolls the core back to a snapshot instead of reloading, then
+// feeds it a keypad stream (or a patched rom) and records pc edges it takes
+// built with CHIP8_BOUNDS_TRAP so every bad access shows up as core.fault
+// each new finding's input is saved next to where it runs; replay mode reruns
+// one of those files and prints the fault
+
+#if CHIP8_BOUNDS_POLICY != CHIP8_BOUNDS_TRAP
+#error "the fuzzer needs CHIP8_BOUNDS_POLICY=CHIP8_BOUNDS_TRAP"
+#endif
+
+const unsigned int COVERAGE_SIZE = 1u << 16u;
+const unsigned int CYCLES_PER_STEP = 64; // cycles each keypad input is held
+const unsigned int MAX_STEPS = 256;      // longest input we'll try
+const unsigned int MAX_PATCHES = 8;      // rom bytes changed per input
+
+// one fuzz input; a keypad bitmask per step plus optional rom patches
+struct Input {
+  std::vector<std::uint16_t> keys;
+  std::vector<std::pair<std::uint16_t, std::uint8_t>> patches;
+};
+
+// a bounds violation; kind plus where it happened is what we dedupe on
+struct Finding {
+  std::string kind;
+  std::uint16_t pc;
+  std::uint16_t opcode;
+
+  bool operator<(const Finding &other) const {
+    if (pc != other.pc) {
+      return pc < other.pc;
+    }
+    return kind < other.kind;
+  }
+};
+
+std::mutex findingsLock;
+std::set<Finding> findings;
+std::atomic<unsigned long> totalExecs{0};
+std::atomic<bool> stop{false};
+
+// edges every worker has seen; a byte per slot so setting one is a plain store
+std::atomic<std::uint8_t> coverage[COVERAGE_SIZE];
+
+// inputs that found new edges, from any worker; workers pull what they
+// haven't seen every so often
+std::mutex corpusLock;
+std::vector<Input> sharedCorpus;
+
+// how many execs between pulls from the shared corpus
+const unsigned long CORPUS_SYNC_EXECS = 256;
+
+// afl-style: every pc gets a fixed random id so edges spread over the whole
+// map instead of the few thousand slots raw addresses would reach
+std::uint16_t pcIds[MEMORY_SIZE];
+
+void InitPcIds() {
+  std::mt19937 rng(0xC8);
+  for (unsigned int i = 0; i < MEMORY_SIZE; ++i) {
+    pcIds[i] = rng() & (COVERAGE_SIZE - 1);
+  }
+}
+
+// edges one exec took; the byte map dedupes, the list is what we walk after,
+// so an exec costs what it touched rather than the whole map
+struct Trace {
+  std::vector<std::uint8_t> seen = std::vector<std::uint8_t>(COVERAGE_SIZE);
+  std::vector<std::uint16_t> hits;
+
+  void Hit(std::uint16_t edge) {
+    if (!seen[edge]) {
+      seen[edge] = 1;
+      hits.push_back(edge);
+    }
+  }
+};
+
+// run one input from the snapshot; fills trace, returns true if the core
+// faulted (details are in core.fault)
+bool Execute(CHIP8 &core, const Snapshot &snapshot, const Input &input,
+             Trace &trace) {
+  snapshot.Restore(core);
+
+  // patched bytes need to be undone on the next restore, so mark them
+  for (const auto &patch : input.patches) {
+    core.memory[patch.first] = patch.second;
+    core.dirtyPages |= 1u << (patch.first >> 8u);
+  }
+
+  std::uint16_t prevId = pcIds[core.pc & (MEMORY_SIZE - 1)];
+
+  for (std::uint16_t keys : input.keys) {
+    for (unsigned int i = 0; i < 16; ++i) {
+      core.keypad[i] = (keys >> i) & 1u;
+    }
+
+    for (unsigned int cycle = 0; cycle < CYCLES_PER_STEP; ++cycle) {
+      core.Cycle();
+
+      if (core.fault.type != FAULT_NONE) {
+        return true;
+      }
+
+      // shift keeps a->b and b->a apart
+      std::uint16_t id = pcIds[core.pc & (MEMORY_SIZE - 1)];
+      trace.Hit((prevId >> 1u) ^ id);
+      prevId = id;
+    }
+  }
+
+  return false;
+}
+
+// finding files, so a crash can be replayed:
+// u32 step count, u16 keypad mask per step, u32 patch count, then a u16
+// address and u8 value per patch; everything little endian
+
+static void PutLE(std::ofstream &file, std::uint32_t value, unsigned int bytes) {
+  for (unsigned int i = 0; i < bytes; ++i) {
+    file.put(static_cast<char>((value >> (i * 8)) & 0xFFu));
+  }
+}
+
+static bool GetLE(std::ifstream &file, std::uint32_t &value,
+                  unsigned int bytes) {
+  value = 0;
+  for (unsigned int i = 0; i < bytes; ++i) {
+    int byte = file.get();
+    if (byte == EOF) {
+      return false;
+    }
+    value |= static_cast<std::uint32_t>(byte) << (i * 8);
+  }
+  return true;
+}
+
+bool SaveInput(const std::string &path, const Input &input) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  PutLE(file, input.keys.size(), 4);
+  for (std::uint16_t keys : input.keys) {
+    PutLE(file, keys, 2);
+  }
+  PutLE(file, input.patches.size(), 4);
+  for (const auto &patch : input.patches) {
+    PutLE(file, patch.first, 2);
+    PutLE(file, patch.second, 1);
+  }
+  return file.good();
+}
+
+bool LoadInput(const std::string &path, Input &input) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::uint32_t count;
+  std::uint32_t value;
+  if (!GetLE(file, count, 4) || count > MAX_STEPS) {
+    return false;
+  }
+  input.keys.resize(count);
+  for (std::uint16_t &keys : input.keys) {
+    if (!GetLE(file, value, 2)) {
+      return false;
+    }
+    keys = value;
+  }
+
+  if (!GetLE(file, count, 4) || count > MAX_PATCHES) {
+    return false;
+  }
+  input.patches.resize(count);
+  for (auto &patch : input.patches) {
+    if (!GetLE(file, value, 2) || value >= MEMORY_SIZE) {
+      return false;
+    }
+    patch.first = value;
+    if (!GetLE(file, value, 1)) {
+      return false;
+    }
+    patch.second = value;
+  }
+  return true;
+}
+
+// finding-<kind>-<pc>.bin, with the kind's spaces turned into dashes
+std::string FindingPath(const Fault &fault) {
+  std::string kind = FaultName(fault.type);
+  for (char &c : kind) {
+    if (c == ' ') {
+      c = '-';
+    }
+  }
+
+  char pc[8];
+  std::snprintf(pc, sizeof(pc), "%03X", fault.pc);
+  return "finding-" + kind + "-" + pc + ".bin";
+}
+
+void Mutate(Input &input, std::mt19937 &rng, bool patchRom,
+            std::uint16_t romEnd) {
+  switch (rng() % (patchRom ? 5 : 4)) {
+  case 0:
+    // flip one key in one step
+    if (!input.keys.empty()) {
+      input.keys[rng() % input.keys.size()] ^= 1u << (rng() % 16);
+    }
+    break;
+  case 1:
+    // new random step
+    if (input.keys.size() < MAX_STEPS) {
+      input.keys.insert(input.keys.begin() + rng() % (input.keys.size() + 1),
+                        rng() & 0xFFFFu);
+    }
+    break;
+  case 2:
+    // drop a step
+    if (input.keys.size() > 1) {
+      input.keys.erase(input.keys.begin() + rng() % input.keys.size());
+    }
+    break;
+  case 3:
+    // hold whatever is pressed for longer
+    if (!input.keys.empty() && input.keys.size() < MAX_STEPS) {
+      std::size_t at = rng() % input.keys.size();
+      input.keys.insert(input.keys.begin() + at, input.keys[at]);
+    }
+    break;
+  case 4:
+    // overwrite a rom byte
+    if (input.patches.size() < MAX_PATCHES && romEnd > START_ADDRESS) {
+      std::uint16_t addr = START_ADDRESS + rng() % (romEnd - START_ADDRESS);
+      input.patches.push_back({addr, static_cast<std::uint8_t>(rng())});
+    } else if (!input.patches.empty()) {
+      input.patches[rng() % input.patches.size()].second = rng();
+    }
+    break;
+  }
+}
+
+void Worker(const CHIP8 &base, unsigned int seed, bool patchRom,
+            std::uint16_t romEnd) {
+  // own core, snapshot and rng; coverage and corpus are shared
+  CHIP8 core = base;
+  Snapshot snapshot;
+  snapshot.Save(core);
+
+  std::mt19937 rng(seed);
+  Trace trace;
+
+  // start from one idle step; inputs only get as long as they need to be
+  std::vector<Input> corpus(1);
+  corpus[0].keys.assign(1, 0);
+  std::size_t synced = 0;
+
+  // reused every exec so copying a corpus entry doesn't allocate
+  Input input;
+
+  unsigned long execs = 0;
+
+  while (!stop.load(std::memory_order_relaxed)) {
+    input = corpus[rng() % corpus.size()];
+    unsigned int rounds = 1 + rng() % 4;
+    for (unsigned int i = 0; i < rounds; ++i) {
+      Mutate(input, rng, patchRom, romEnd);
+    }
+
+    bool faulted = Execute(core, snapshot, input, trace);
+    ++execs;
+
+    if (faulted) {
+      const Fault &fault = core.fault;
+
+      std::lock_guard<std::mutex> guard(findingsLock);
+      if (findings.insert({FaultName(fault.type), fault.pc, fault.opcode})
+              .second) {
+        std::string path = FindingPath(fault);
+        bool saved = SaveInput(path, input);
+
+        std::cout << "finding: " << FaultName(fault.type) << " at pc 0x"
+                  << std::hex << fault.pc << " opcode 0x" << fault.opcode
+                  << " address 0x" << fault.address << std::dec << " after "
+                  << input.keys.size() << " steps"
+                  << (saved ? " -> " + path : " (couldn't save input)")
+                  << "\n";
+      }
+    }
+
+    // keep inputs that took anyone somewhere new; only look at what this exec
+    // hit, and only write the shared map when it's actually new
+    bool interesting = false;
+    for (std::uint16_t edge : trace.hits) {
+      trace.seen[edge] = 0;
+      if (!coverage[edge].load(std::memory_order_relaxed) &&
+          !coverage[edge].exchange(1, std::memory_order_relaxed)) {
+        interesting = true;
+      }
+    }
+    trace.hits.clear();
+
+    if (interesting) {
+      corpus.push_back(input);
+
+      std::lock_guard<std::mutex> guard(corpusLock);
+      sharedCorpus.push_back(input);
+    }
+
+    if (execs % CORPUS_SYNC_EXECS == 0) {
+      // pick up what the other workers found (and our own, harmlessly)
+      std::lock_guard<std::mutex> guard(corpusLock);
+      corpus.insert(corpus.end(), sharedCorpus.begin() + synced,
+                    sharedCorpus.end());
+      synced = sharedCorpus.size();
+
+      totalExecs += CORPUS_SYNC_EXECS;
+    }
+  }
+
+  totalExecs += execs % CORPUS_SYNC_EXECS;
+}
+
+// run one saved finding from a fresh load and say how it ended
+int Replay(const CHIP8 &base, const char *path) {
+  Input input;
+  if (!LoadInput(path, input)) {
+    std::cerr << "can't read finding " << path << "\n";
+    return EXIT_FAILURE;
+  }
+
+  CHIP8 core = base;
+  Snapshot snapshot;
+  snapshot.Save(core);
+  Trace trace;
+
+  if (!Execute(core, snapshot, input, trace)) {
+    std::cout << path << ": no fault after " << input.keys.size()
+              << " steps\n";
+    return EXIT_SUCCESS;
+  }
+
+  const Fault &fault = core.fault;
+  std::cout << path << ": " << FaultName(fault.type) << " at pc 0x" << std::hex
+            << fault.pc << " opcode 0x" << fault.opcode << " address 0x"
+            << fault.address << std::dec << "\n";
+  return EXIT_FAILURE;
+}
+
+int main(int argc, const char **argv) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <rom> <seconds> [threads] [keys|rom]\n"
+              << "       " << argv[0] << " <rom> replay <finding>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  const char *romFilename = argv[1];
+
+  if (std::string(argv[2]) == "replay") {
+    if (argc != 4) {
+      std::cerr << "Usage: " << argv[0] << " <rom> replay <finding>\n";
+      std::exit(EXIT_FAILURE);
+    }
+
+    CHIP8 base;
+    base.LoadROM(romFilename);
+    InitPcIds();
+    return Replay(base, argv[3]);
+  }
+
+  int seconds = std::stoi(argv[2]);
+  unsigned int threads = std::thread::hardware_concurrency();
+  if (argc > 3) {
+    threads = std::stoi(argv[3]);
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+  bool patchRom = argc > 4 && std::string(argv[4]) == "rom";
+
+  CHIP8 base;
+  base.LoadROM(romFilename);
+
+  // patches stay inside the loaded rom; find where it ends
+  std::uint16_t romEnd = MEMORY_SIZE;
+  while (romEnd > START_ADDRESS && base.memory[romEnd - 1] == 0) {
+    --romEnd;
+  }
+
+  InitPcIds();
+  std::vector<std::thread> workers;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (unsigned int i = 0; i < threads; ++i) {
+    workers.emplace_back(Worker, std::cref(base), i + 1, patchRom, romEnd);
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  float elapsed = std::chrono::duration<float>(
+                      std::chrono::high_resolution_clock::now() - start)
+                      .count();
+
+  unsigned int edges = 0;
+  for (unsigned int i = 0; i < COVERAGE_SIZE; ++i) {
+    edges += coverage[i].load(std::memory_order_relaxed);
+  }
+
+  std::cout << totalExecs << " execs in " << elapsed << "s ("
+            << static_cast<unsigned long>(totalExecs / elapsed)
+            << " execs/s), " << edges << " edges, " << findings.size()
+            << " findings\n";
+
+  return findings.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,50 @@
+#include <algorithm>
+
+#include "governor.h"
+
+// back off hard when over budget, creep up when under half of it
+const float GOVERNOR_BACKOFF = 0.75f;
+const float GOVERNOR_HEADROOM = 0.5f;
+const float GOVERNOR_STEP = 0.05f;
+
+Governor::Governor(unsigned int minCycles, unsigned int maxCycles)
+    : minCycles(std::max(1u, minCycles)),
+      maxCycles(std::max(std::max(1u, minCycles), maxCycles)),
+      rate(this->maxCycles) {}
+
+float Governor::Low() const { return std::max(1.0f, minCycles * speed); }
+
+float Governor::High() const { return std::max(Low(), maxCycles * speed); }
+
+unsigned int Governor::Cycles() const {
+  return static_cast<unsigned int>(std::clamp(rate, Low(), High()) + 0.5f);
+}
+
+void Governor::FrameDone(float workMs) {
+  ++frames;
+
+  if (workMs > FRAME_BUDGET_MS) {
+    // this frame ran late; the host can't keep up at this rate
+    ++dropped;
+    rate *= GOVERNOR_BACKOFF;
+  } else if (workMs < FRAME_BUDGET_MS * GOVERNOR_HEADROOM) {
+    rate += std::max(1.0f, rate * GOVERNOR_STEP);
+  }
+
+  rate = std::clamp(rate, Low(), High());
+}
+
+void Governor::SetSpeed(float newSpeed) {
+  if (newSpeed == speed) {
+    return;
+  }
+
+  rate = std::clamp(rate * newSpeed / speed, 1.0f, maxCycles * newSpeed);
+  speed = newSpeed;
+}
+
+float Governor::Speed() const { return speed; }
+
+unsigned long Governor::Frames() const { return frames; }
+
+unsigned long Governor::Dropped() const { return dropped; }
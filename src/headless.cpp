@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture.h"
+#include "checkpoint.h"
+#include "core.h"
+
+// runs roms with no window; for scripted runs and regression archives
+
+void Usage(const char *name) {
+  std::cerr << "Usage: " << name << " run <rom> <frames> [raw|png|y4m <out>]\n"
+            << "       " << name << " record <rom> <frames> <every> <out.chk>\n"
+            << "       " << name << " verify <dir> [threads]\n"
+            << "       " << name << " sweep <dir> <frames> [threads]\n";
+  std::exit(EXIT_FAILURE);
+}
+
+// one emulated frame; false once the core has faulted
+bool RunFrame(CHIP8 &core) {
+  for (unsigned int cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle) {
+    core.Cycle();
+  }
+  return core.fault.type == FAULT_NONE;
+}
+
+void PrintFault(const std::string &rom, const CHIP8 &core) {
+  std::cerr << rom << ": " << FaultName(core.fault.type) << " at pc 0x"
+            << std::hex << core.fault.pc << " opcode 0x" << core.fault.opcode
+            << std::dec << "\n";
+}
+
+int Run(int argc, const char **argv) {
+  if (argc != 4 && argc != 6) {
+    Usage(argv[0]);
+  }
+
+  const char *romFilename = argv[2];
+  unsigned long frames = std::stoul(argv[3]);
+
+  std::unique_ptr<Capture> capture;
+  if (argc == 6) {
+    CaptureFormat format;
+    if (!ParseCaptureFormat(argv[4], format)) {
+      Usage(argv[0]);
+    }
+
+    capture.reset(new Capture(format, argv[5]));
+    if (!capture->IsOpen()) {
+      std::cerr << "can't open " << argv[5] << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  CHIP8 core;
+  core.LoadROM(romFilename);
+
+  for (unsigned long frame = 0; frame < frames; ++frame) {
+    bool ok = RunFrame(core);
+
+    if (capture) {
+      capture->Push(core);
+    }
+
+    if (!ok) {
+      break;
+    }
+  }
+
+  if (capture) {
+    capture->Finish();
+  }
+
+  if (core.fault.type != FAULT_NONE) {
+    PrintFault(romFilename, core);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int Record(int argc, const char **argv) {
+  if (argc != 6) {
+    Usage(argv[0]);
+  }
+
+  const char *romFilename = argv[2];
+  unsigned long frames = std::stoul(argv[3]);
+  unsigned long every = std::stoul(argv[4]);
+  if (every == 0) {
+    Usage(argv[0]);
+  }
+
+  CHIP8 core;
+  core.LoadROM(romFilename);
+
+  std::vector<Checkpoint> checkpoints;
+  for (unsigned long frame = 1; frame <= frames; ++frame) {
+    if (!RunFrame(core)) {
+      PrintFault(romFilename, core);
+      return EXIT_FAILURE;
+    }
+
+    if (frame % every == 0) {
+      checkpoints.push_back({frame, core.VideoHash()});
+    }
+  }
+
+  if (!SaveCheckpoints(argv[5], checkpoints)) {
+    std::cerr << "can't write " << argv[5] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+std::mutex outputLock;
+
+// run one rom against its checkpoints; gives up early if another rom already
+// failed
+bool VerifyROM(const std::string &rom, const std::atomic<bool> &failed) {
+  std::vector<Checkpoint> checkpoints;
+  if (!LoadCheckpoints((rom + ".chk").c_str(), checkpoints)) {
+    std::lock_guard<std::mutex> guard(outputLock);
+    std::cerr << rom << ": bad checkpoint file\n";
+    return false;
+  }
+
+  CHIP8 core;
+  core.LoadROM(rom.c_str());
+
+  unsigned long frame = 0;
+  for (const Checkpoint &checkpoint : checkpoints) {
+    while (frame < checkpoint.frame) {
+      if (failed.load(std::memory_order_relaxed)) {
+        return true;
+      }
+
+      if (!RunFrame(core)) {
+        std::lock_guard<std::mutex> guard(outputLock);
+        PrintFault(rom, core);
+        return false;
+      }
+      ++frame;
+    }
+
+    std::uint64_t hash = core.VideoHash();
+    if (hash != checkpoint.hash) {
+      std::lock_guard<std::mutex> guard(outputLock);
+      std::cerr << rom << ": mismatch at frame " << frame << ", expected "
+                << std::hex << checkpoint.hash << " got " << hash << std::dec
+                << "\n";
+      return false;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(outputLock);
+  std::cout << rom << ": ok (" << checkpoints.size() << " checkpoints)\n";
+  return true;
+}
+
+// every .ch8 in dir, sorted so reports are stable; false if unreadable
+bool ListROMs(const char *dir, std::vector<std::string> &roms) {
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+    if (entry.path().extension() == ".ch8") {
+      roms.push_back(entry.path().string());
+    }
+  }
+  std::sort(roms.begin(), roms.end());
+  return !error;
+}
+
+// run fn(index) for every index below count across a few threads; workers
+// stop picking up jobs once stop is set
+template <typename Fn>
+void ForEachParallel(std::size_t count, unsigned int threads,
+                     const std::atomic<bool> &stop, Fn fn) {
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> workers;
+
+  for (unsigned int i = 0; i < threads; ++i) {
+    workers.emplace_back([&] {
+      while (!stop) {
+        std::size_t job = next++;
+        if (job >= count) {
+          break;
+        }
+        fn(job);
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+unsigned int ThreadCount(int argc, const char **argv, int position) {
+  unsigned int threads = std::thread::hardware_concurrency();
+  if (argc > position) {
+    threads = std::stoi(argv[position]);
+  }
+  return threads ? threads : 1;
+}
+
+int Verify(int argc, const char **argv) {
+  if (argc != 3 && argc != 4) {
+    Usage(argv[0]);
+  }
+
+  unsigned int threads = ThreadCount(argc, argv, 3);
+
+  // every rom in the directory that has checkpoints next to it
+  std::vector<std::string> all;
+  if (!ListROMs(argv[2], all)) {
+    std::cerr << "can't read " << argv[2] << "\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> roms;
+  for (const std::string &rom : all) {
+    if (std::filesystem::exists(rom + ".chk")) {
+      roms.push_back(rom);
+    }
+  }
+
+  std::atomic<bool> failed{false};
+  ForEachParallel(roms.size(), threads, failed, [&](std::size_t job) {
+    if (!VerifyROM(roms[job], failed)) {
+      failed = true;
+    }
+  });
+
+  if (failed) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << roms.size() << " roms verified\n";
+  return EXIT_SUCCESS;
+}
+
+// sweep classes, worst first
+enum SweepClass { SWEEP_FAULT, SWEEP_UNKNOWN_OPCODE, SWEEP_STALLED, SWEEP_OK };
+
+const char *SWEEP_CLASS_NAMES[] = {"fault", "unknown-op", "stalled", "ok"};
+
+// a rom whose pc stays within one instruction of where it was for this many
+// frames in a row, with nothing drawn, is stuck (spinning on 1nnn to itself,
+// or sitting in Fx0A with nobody pressing keys)
+const unsigned long STALL_FRAMES = 60;
+
+// opcode mix buckets, one per handler the core can dispatch to: the 0, 8 and
+// E tables by low nibble, the F table by low byte, the rest by top nibble, and
+// every unknown opcode together under OP_NULL
+const unsigned int MIX_TABLE0 = 0x000;
+const unsigned int MIX_TABLE8 = 0x010;
+const unsigned int MIX_TABLEE = 0x020;
+const unsigned int MIX_TABLEF = 0x030;
+const unsigned int MIX_PRIMARY = 0x130;
+const unsigned int MIX_NULL = 0x140;
+const unsigned int MIX_SIZE = 0x141;
+
+// same indexing as the dispatch tables in the CHIP8 constructor
+unsigned int MixBucket(std::uint16_t opcode) {
+  unsigned int top = (opcode & 0xF000u) >> 12u;
+  switch (top) {
+  case 0x0:
+    return MIX_TABLE0 + (opcode & 0x000Fu);
+  case 0x8:
+    return MIX_TABLE8 + (opcode & 0x000Fu);
+  case 0xE:
+    return MIX_TABLEE + (opcode & 0x000Fu);
+  case 0xF:
+    return MIX_TABLEF + (opcode & 0x00FFu);
+  default:
+    return MIX_PRIMARY + top;
+  }
+}
+
+// handler name for a bucket, e.g. 8xy4 or Fx33; only buckets with a real
+// handler behind them ever get counted, the rest go to MIX_NULL
+void MixLabel(unsigned int bucket, char *label, std::size_t size) {
+  static const char *PRIMARY_LABELS[16] = {
+      "",     "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+      "",     "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "",     ""};
+
+  if (bucket == MIX_NULL) {
+    std::snprintf(label, size, "NULL");
+  } else if (bucket >= MIX_PRIMARY) {
+    std::snprintf(label, size, "%s", PRIMARY_LABELS[bucket - MIX_PRIMARY]);
+  } else if (bucket >= MIX_TABLEF) {
+    std::snprintf(label, size, "Fx%02X", bucket - MIX_TABLEF);
+  } else if (bucket >= MIX_TABLEE) {
+    std::snprintf(label, size, "%s",
+                  bucket - MIX_TABLEE == 0x1 ? "ExA1" : "Ex9E");
+  } else if (bucket >= MIX_TABLE8) {
+    std::snprintf(label, size, "8xy%X", bucket - MIX_TABLE8);
+  } else {
+    std::snprintf(label, size, "00E%X", bucket - MIX_TABLE0);
+  }
+}
+
+struct SweepResult {
+  SweepClass result;
+  std::string detail;
+  unsigned long cycles;
+  double seconds;
+  unsigned long mix[MIX_SIZE]; // instructions run, by handler
+  unsigned int peakStack;
+};
+
+SweepResult SweepROM(const std::string &rom, unsigned long frames) {
+  SweepResult result = {SWEEP_OK, "", 0, 0, {0}, 0};
+
+  CHIP8 core;
+  core.LoadROM(rom.c_str());
+
+  unsigned long stillFrames = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned long frame = 0; frame < frames; ++frame) {
+    std::uint16_t lowPc = core.pc;
+    std::uint16_t highPc = core.pc;
+    std::uint64_t hash = core.VideoHash();
+
+    for (unsigned int cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle) {
+      unsigned long unknown = core.unknownOpcodes;
+      core.Cycle();
+      if (core.fault.type != FAULT_NONE) {
+        break;
+      }
+
+      ++result.cycles;
+      ++result.mix[core.unknownOpcodes != unknown ? MIX_NULL
+                                                  : MixBucket(core.opcode)];
+      result.peakStack = std::max<unsigned int>(result.peakStack, core.sp);
+      lowPc = std::min(lowPc, core.pc);
+      highPc = std::max(highPc, core.pc);
+    }
+
+    if (core.fault.type != FAULT_NONE) {
+      break;
+    }
+
+    bool still = highPc - lowPc <= 2 && core.VideoHash() == hash;
+    stillFrames = still ? stillFrames + 1 : 0;
+    if (stillFrames >= STALL_FRAMES) {
+      break;
+    }
+  }
+
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  char detail[96];
+  if (core.fault.type != FAULT_NONE) {
+    result.result = SWEEP_FAULT;
+    std::snprintf(detail, sizeof(detail), "%s at pc 0x%03X op 0x%04X",
+                  FaultName(core.fault.type), core.fault.pc,
+                  core.fault.opcode);
+    result.detail = detail;
+  } else if (core.unknownOpcodes) {
+    result.result = SWEEP_UNKNOWN_OPCODE;
+    std::snprintf(detail, sizeof(detail), "%lu times, last 0x%04X",
+                  core.unknownOpcodes, core.lastUnknownOpcode);
+    result.detail = detail;
+  } else if (stillFrames >= STALL_FRAMES) {
+    result.result = SWEEP_STALLED;
+    std::snprintf(detail, sizeof(detail), "at pc 0x%03X", core.pc);
+    result.detail = detail;
+  }
+
+  return result;
+}
+
+int Sweep(int argc, const char **argv) {
+  if (argc != 4 && argc != 5) {
+    Usage(argv[0]);
+  }
+
+  unsigned long frames = std::stoul(argv[3]);
+  unsigned int threads = ThreadCount(argc, argv, 4);
+
+  std::vector<std::string> roms;
+  if (!ListROMs(argv[2], roms)) {
+    std::cerr << "can't read " << argv[2] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<SweepResult> results(roms.size());
+  std::atomic<bool> never{false};
+  ForEachParallel(roms.size(), threads, never, [&](std::size_t job) {
+    results[job] = SweepROM(roms[job], frames);
+  });
+
+  // one line per rom: class, speed, stack, three busiest handlers
+  unsigned int counts[4] = {0};
+  unsigned int order[MIX_SIZE];
+  for (std::size_t i = 0; i < roms.size(); ++i) {
+    const SweepResult &result = results[i];
+    ++counts[result.result];
+
+    double mips = result.seconds > 0 ? result.cycles / result.seconds / 1e6 : 0;
+
+    for (unsigned int n = 0; n < MIX_SIZE; ++n) {
+      order[n] = n;
+    }
+    std::partial_sort(order, order + 3, order + MIX_SIZE,
+                      [&](unsigned int a, unsigned int b) {
+                        return result.mix[a] > result.mix[b];
+                      });
+
+    char line[256];
+    int length = std::snprintf(line, sizeof(line), "%-10s %8.1f MIPS  stack %2u ",
+                               SWEEP_CLASS_NAMES[result.result], mips,
+                               result.peakStack);
+    for (unsigned int n = 0; n < 3 && result.mix[order[n]]; ++n) {
+      char label[8];
+      MixLabel(order[n], label, sizeof(label));
+      length += std::snprintf(line + length, sizeof(line) - length,
+                              " %s %4.1f%%", label,
+                              100.0 * result.mix[order[n]] / result.cycles);
+    }
+
+    std::cout << line << "  " << roms[i];
+    if (!result.detail.empty()) {
+      std::cout << " (" << result.detail << ")";
+    }
+    std::cout << "\n";
+  }
+
+  std::cout << roms.size() << " roms: " << counts[SWEEP_OK] << " ok, "
+            << counts[SWEEP_UNKNOWN_OPCODE] << " unknown-op, "
+            << counts[SWEEP_STALLED] << " stalled, " << counts[SWEEP_FAULT]
+            << " fault\n";
+
+  return counts[SWEEP_OK] == roms.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, const char **argv) {
+  if (argc < 2) {
+    Usage(argv[0]);
+  }
+
+  if (std::strcmp(argv[1], "run") == 0) {
+    return Run(argc, argv);
+  }
+
+  if (std::strcmp(argv[1], "record") == 0) {
+    return Record(argc, argv);
+  }
+
+  if (std::strcmp(argv[1], "verify") == 0) {
+    return Verify(argc, argv);
+  }
+
+  if (std::strcmp(argv[1], "sweep") == 0) {
+    return Sweep(argc, argv);
+  }
+
+  Usage(argv[0]);
+  return EXIT_FAILURE;
+}
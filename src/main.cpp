@@ -1,53 +1,116 @@
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
 
 #include "core.h"
+#include "governor.h"
 #include "platform.h"
 
+// speed multipliers for the hotkeys
+const float FAST_FORWARD_SPEED = 4.0f;
+const float SLOW_MOTION_SPEED = 0.25f;
+
 int main(int argc, const char **argv) {
   // gather arguments, pretty straightforward stuff
-  if (argc != 4) {
-    std::cerr << "Usage: " << argv[0] << "<scale> <delay> <rom>\n";
+  if (argc != 5 && argc != 6) {
+    std::cerr << "Usage: " << argv[0]
+              << " <scale> <min-cycles> <max-cycles> <rom> [gpu|cpu|crt]\n"
+              << "  cycles are instructions per 60hz frame; the rate is tuned "
+                 "between them to what this machine keeps up with\n"
+              << "  hold tab to fast forward, space for slow motion\n";
     std::exit(EXIT_FAILURE);
   }
 
   int videoScale = std::stoi(argv[1]);
-  int cycleDelay = std::stoi(argv[2]);
-  const char *romFilename = argv[3];
+  unsigned int minCycles = std::stoi(argv[2]);
+  unsigned int maxCycles = std::stoi(argv[3]);
+  const char *romFilename = argv[4];
+
+  // gpu unless asked; cpu/crt draw straight to the window surface
+  RenderMode renderMode = RENDER_GPU;
+  if (argc == 6 && !ParseRenderMode(argv[5], renderMode)) {
+    std::cerr << "render mode must be gpu, cpu or crt\n";
+    std::exit(EXIT_FAILURE);
+  }
 
   // start up platform
   Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * videoScale,
-                    VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
+                    VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT,
+                    renderMode);
 
   // start core, load rom
   CHIP8 core;
   core.LoadROM(romFilename);
 
+  Governor governor(minCycles, maxCycles);
+  Hotkeys hotkeys;
+
   // pitch is length of scanline; amt. of pixels to get to the pixel below it
   // makes sense; we're storing display data as an 1-d array
   int videoPitch = sizeof(core.video[0]) * VIDEO_WIDTH;
 
-  // store program time this cycle
-  auto lastCycleTime = std::chrono::high_resolution_clock::now();
+  // fixed 60hz frames; sleep_until so we don't drift
+  const auto frameTime = std::chrono::microseconds(1000000 / 60);
+  auto nextFrame = std::chrono::steady_clock::now();
+
+  // stats shown once a second
+  auto lastReport = nextFrame;
+  unsigned long reportFrames = governor.Frames();
+  unsigned long reportDropped = governor.Dropped();
+  bool faultReported = false;
 
   bool quit = false;
   while (!quit) {
-    quit = platform.ProcessInput(core.keypad);
+    auto frameStart = std::chrono::steady_clock::now();
 
-    // take difference in time between last and curr. frame; deltatime
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+    quit = platform.ProcessInput(core.keypad, &hotkeys);
 
-    // if deltatimer exceeds cycle delay, well, cycle!
-    // you've seen this before
-    if (dt > cycleDelay) {
-      lastCycleTime = currentTime;
+    float speed = 1.0f;
+    if (hotkeys.fastForward) {
+      speed = FAST_FORWARD_SPEED;
+    } else if (hotkeys.slowMotion) {
+      speed = SLOW_MOTION_SPEED;
+    }
+    governor.SetSpeed(speed);
 
+    unsigned int cycles = governor.Cycles();
+    for (unsigned int i = 0; i < cycles; ++i) {
       core.Cycle();
+    }
+
+    platform.Update(core.video, videoPitch);
+
+    // only the work counts, not the time we'd have slept anyway
+    float workMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    governor.FrameDone(workMs);
+
+    if (core.fault.type != FAULT_NONE && !faultReported) {
+      std::cerr << romFilename << ": " << FaultName(core.fault.type) << " at pc 0x" << std::hex << core.fault.pc
+                << " opcode 0x" << core.fault.opcode << std::dec << "\n";
+      faultReported = true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastReport >= std::chrono::seconds(1)) {
+      char status[128];
+      std::snprintf(status, sizeof(status), "CHIP-8 Emulator - %u cycles/frame x%.2g - %lu/%lu frames dropped", cycles,
+                    governor.Speed(), governor.Dropped() - reportDropped, governor.Frames() - reportFrames);
+      platform.SetTitle(status);
+      std::cout << status << "\n";
+
+      lastReport = now;
+      reportFrames = governor.Frames();
+      reportDropped = governor.Dropped();
+    }
 
-      platform.Update(core.video, videoPitch);
+    // fell more than a frame behind; don't try to catch up in a burst
+    nextFrame += frameTime;
+    if (nextFrame < now) {
+      nextFrame = now;
     }
+    std::this_thread::sleep_until(nextFrame);
   }
 
   return 0;
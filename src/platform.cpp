@@ -1,30 +1,189 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
 #include "platform.h"
 
-Platform::Platform(const char *title, int windowWidth, int windowHeight, int textureWidth, int textureHeight) {
+// how much brightness a lit-then-cleared pixel keeps each frame in CRT mode,
+// out of 256; 160 drops it below a quarter after 3 frames and to 0 after 11
+const unsigned int PHOSPHOR_DECAY = 160;
+
+bool ParseRenderMode(const char *name, RenderMode &mode) {
+  if (std::strcmp(name, "gpu") == 0) {
+    mode = RENDER_GPU;
+  } else if (std::strcmp(name, "cpu") == 0) {
+    mode = RENDER_CPU;
+  } else if (std::strcmp(name, "crt") == 0) {
+    mode = RENDER_CRT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Platform::Platform(const char *title, int windowWidth, int windowHeight, int textureWidth, int textureHeight,
+                   RenderMode mode)
+    : mode(mode), textureWidth(textureWidth), textureHeight(textureHeight) {
   SDL_Init(SDL_INIT_VIDEO);
 
   window = SDL_CreateWindow(title, 0, 0, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
-  renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+
+  if (mode == RENDER_GPU) {
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+  } else {
+    // a window with a renderer can't also hand out its surface, so no
+    // renderer at all here
+    phosphor.assign(textureWidth * textureHeight, 0);
+    palette.assign(256, 0);
+  }
 }
 
 Platform::~Platform() {
-  SDL_DestroyTexture(texture);
-  SDL_DestroyRenderer(renderer);
+  if (texture) {
+    SDL_DestroyTexture(texture);
+  }
+  if (renderer) {
+    SDL_DestroyRenderer(renderer);
+  }
   SDL_DestroyWindow(window);
   SDL_Quit();
 }
 
 void Platform::Update(const void *buffer, int pitch) {
+  if (mode != RENDER_GPU) {
+    UpdateSurface(static_cast<const std::uint32_t *>(buffer), pitch);
+    return;
+  }
+
   SDL_UpdateTexture(texture, nullptr, buffer, pitch);
   SDL_RenderClear(renderer);
   SDL_RenderCopy(renderer, texture, nullptr, nullptr);
   SDL_RenderPresent(renderer);
 }
 
-bool Platform::ProcessInput(std::uint8_t *keys) {
+// one row of brightness levels out to surface pixels, each repeated `scale`
+// times; fill_n on a constant compiles down to wide stores
+template <typename Pixel>
+static void ExpandRow(std::uint8_t *out, const std::uint8_t *level, int width, int scale,
+                      const std::uint32_t *palette) {
+  Pixel *pixels = reinterpret_cast<Pixel *>(out);
+  for (int x = 0; x < width; ++x) {
+    std::fill_n(pixels + x * scale, scale, static_cast<Pixel>(palette[level[x]]));
+  }
+}
+
+// 24 bit surfaces have no integer type to fill with; 3 bytes in sdl's order
+static void ExpandRow24(std::uint8_t *out, const std::uint8_t *level, int width, int scale,
+                        const std::uint32_t *palette) {
+  for (int x = 0; x < width; ++x) {
+    std::uint32_t value = palette[level[x]];
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    const std::uint8_t bytes[3] = {std::uint8_t(value), std::uint8_t(value >> 8u), std::uint8_t(value >> 16u)};
+#else
+    const std::uint8_t bytes[3] = {std::uint8_t(value >> 16u), std::uint8_t(value >> 8u), std::uint8_t(value)};
+#endif
+    for (int i = 0; i < scale; ++i) {
+      std::memcpy(out + (x * scale + i) * 3, bytes, 3);
+    }
+  }
+}
+
+void Platform::UpdateSurface(const std::uint32_t *buffer, int pitch) {
+  // sdl only reallocates this if the window changed size
+  SDL_Surface *surface = SDL_GetWindowSurface(window);
+  if (!surface) {
+    return;
+  }
+
+  // window surfaces come in whatever depth the display has, usually 4 bytes a
+  // pixel but not always
+  int bytesPerPixel = surface->format->BytesPerPixel;
+  if (bytesPerPixel < 1 || bytesPerPixel > 4) {
+    if (!surfaceReported) {
+      std::cerr << "can't draw to a " << bytesPerPixel << " byte per pixel window surface\n";
+      surfaceReported = true;
+    }
+    return;
+  }
+
+  // whole pixels only; leftover border stays whatever it was
+  int scale = std::min(surface->w / textureWidth, surface->h / textureHeight);
+  if (scale <= 0) {
+    return;
+  }
+
+  // map brightness to the surface's own pixel format, once per format
+  if (paletteFormat != surface->format->format) {
+    for (unsigned int i = 0; i < 256; ++i) {
+      palette[i] = SDL_MapRGB(surface->format, i, i, i);
+    }
+    paletteFormat = surface->format->format;
+  }
+
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_LockSurface(surface);
+  }
+
+  int sourceStride = pitch / sizeof(std::uint32_t);
+
+  for (int y = 0; y < textureHeight; ++y) {
+    const std::uint32_t *source = buffer + y * sourceStride;
+    std::uint8_t *level = &phosphor[y * textureWidth];
+
+    std::uint8_t *first = static_cast<std::uint8_t *>(surface->pixels) + y * scale * surface->pitch;
+
+    for (int x = 0; x < textureWidth; ++x) {
+      if (source[x]) {
+        level[x] = 255;
+      } else if (mode == RENDER_CRT) {
+        level[x] = (level[x] * PHOSPHOR_DECAY) >> 8u;
+      } else {
+        level[x] = 0;
+      }
+    }
+
+    // first output row: each source pixel becomes `scale` copies
+    switch (bytesPerPixel) {
+    case 1:
+      ExpandRow<std::uint8_t>(first, level, textureWidth, scale, palette.data());
+      break;
+    case 2:
+      ExpandRow<std::uint16_t>(first, level, textureWidth, scale, palette.data());
+      break;
+    case 3:
+      ExpandRow24(first, level, textureWidth, scale, palette.data());
+      break;
+    default:
+      ExpandRow<std::uint32_t>(first, level, textureWidth, scale, palette.data());
+      break;
+    }
+
+    // the other scale - 1 rows are identical; just copy the first one
+    for (int row = 1; row < scale; ++row) {
+      std::memcpy(static_cast<std::uint8_t *>(surface->pixels) + (y * scale + row) * surface->pitch, first,
+                  textureWidth * scale * bytesPerPixel);
+    }
+  }
+
+  if (SDL_MUSTLOCK(surface)) {
+    SDL_UnlockSurface(surface);
+  }
+
+  SDL_UpdateWindowSurface(window);
+}
+
+void Platform::SetTitle(const char *title) { SDL_SetWindowTitle(window, title); }
+
+bool Platform::ProcessInput(std::uint8_t *keys, Hotkeys *hotkeys) {
   bool quit = false;
 
+  // callers that don't care still need somewhere to write to
+  Hotkeys ignored;
+  if (!hotkeys) {
+    hotkeys = &ignored;
+  }
+
   SDL_Event event;
 
   while (SDL_PollEvent(&event)) {
@@ -37,6 +196,12 @@ bool Platform::ProcessInput(std::uint8_t *keys) {
       case SDLK_ESCAPE:
         quit = true;
         break;
+      case SDLK_TAB:
+        hotkeys->fastForward = true;
+        break;
+      case SDLK_SPACE:
+        hotkeys->slowMotion = true;
+        break;
       case SDLK_x:
         keys[0] = 1;
         break;
@@ -92,6 +257,12 @@ bool Platform::ProcessInput(std::uint8_t *keys) {
       case SDLK_ESCAPE:
         quit = true;
         break;
+      case SDLK_TAB:
+        hotkeys->fastForward = false;
+        break;
+      case SDLK_SPACE:
+        hotkeys->slowMotion = false;
+        break;
       case SDLK_x:
         keys[0] = 0;
         break;
@@ -0,0 +1,323 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "core.h"
+
+// ahead of time translator: rom in, c++ translation unit out
+// walks every instruction reachable from 0x200 with static control flow and
+// emits one label per instruction; static jumps become gotos, everything else
+// (RET, Bnnn, jumps out of the rom) goes through a switch on pc
+// the output defines one RecompProgram named by the caller; declare it
+// extern const and link with core.cpp and recomp_runtime.cpp; see recomp.h
+
+// how control leaves an instruction
+enum Flow {
+  FLOW_NEXT,   // falls through to addr + 2
+  FLOW_JUMP,   // goes to nnn
+  FLOW_CALL,   // goes to nnn, comes back to addr + 2
+  FLOW_SKIP,   // addr + 2 or addr + 4
+  FLOW_WAIT,   // Fx0A; stays on addr until a key is down
+  FLOW_DYNAMIC // RET, Bnnn; only known at run time
+};
+
+struct Decoded {
+  const char *handler;
+  Flow flow;
+};
+
+// mirrors the dispatch tables in the CHIP8 constructor, quirks included; the
+// secondary tables only look at the low nibble (or byte for F)
+Decoded Decode(std::uint16_t opcode) {
+  switch ((opcode & 0xF000u) >> 12u) {
+  case 0x0:
+    switch (opcode & 0x000Fu) {
+    case 0x0:
+      return {"OP_00E0", FLOW_NEXT};
+    case 0xE:
+      return {"OP_00EE", FLOW_DYNAMIC};
+    }
+    break;
+  case 0x1:
+    return {"OP_1nnn", FLOW_JUMP};
+  case 0x2:
+    return {"OP_2nnn", FLOW_CALL};
+  case 0x3:
+    return {"OP_3xkk", FLOW_SKIP};
+  case 0x4:
+    return {"OP_4xkk", FLOW_SKIP};
+  case 0x5:
+    return {"OP_5xy0", FLOW_SKIP};
+  case 0x6:
+    return {"OP_6xkk", FLOW_NEXT};
+  case 0x7:
+    return {"OP_7xkk", FLOW_NEXT};
+  case 0x8:
+    switch (opcode & 0x000Fu) {
+    case 0x0:
+      return {"OP_8xy0", FLOW_NEXT};
+    case 0x1:
+      return {"OP_8xy1", FLOW_NEXT};
+    case 0x2:
+      return {"OP_8xy2", FLOW_NEXT};
+    case 0x3:
+      return {"OP_8xy3", FLOW_NEXT};
+    case 0x4:
+      return {"OP_8xy4", FLOW_NEXT};
+    case 0x5:
+      return {"OP_8xy5", FLOW_NEXT};
+    case 0x6:
+      return {"OP_8xy6", FLOW_NEXT};
+    case 0x7:
+      return {"OP_8xy7", FLOW_NEXT};
+    case 0xE:
+      return {"OP_8xyE", FLOW_NEXT};
+    }
+    break;
+  case 0x9:
+    return {"OP_9xy0", FLOW_SKIP};
+  case 0xA:
+    return {"OP_Annn", FLOW_NEXT};
+  case 0xB:
+    return {"OP_Bnnn", FLOW_DYNAMIC};
+  case 0xC:
+    return {"OP_Cxkk", FLOW_NEXT};
+  case 0xD:
+    return {"OP_Dxyn", FLOW_NEXT};
+  case 0xE:
+    switch (opcode & 0x000Fu) {
+    case 0x1:
+      return {"OP_ExA1", FLOW_SKIP};
+    case 0xE:
+      return {"OP_Ex9E", FLOW_SKIP};
+    }
+    break;
+  case 0xF:
+    switch (opcode & 0x00FFu) {
+    case 0x07:
+      return {"OP_Fx07", FLOW_NEXT};
+    case 0x0A:
+      return {"OP_Fx0A", FLOW_WAIT};
+    case 0x15:
+      return {"OP_Fx15", FLOW_NEXT};
+    case 0x18:
+      return {"OP_Fx18", FLOW_NEXT};
+    case 0x1E:
+      return {"OP_Fx1E", FLOW_NEXT};
+    case 0x29:
+      return {"OP_Fx29", FLOW_NEXT};
+    case 0x33:
+      return {"OP_Fx33", FLOW_NEXT};
+    case 0x55:
+      return {"OP_Fx55", FLOW_NEXT};
+    case 0x65:
+      return {"OP_Fx65", FLOW_NEXT};
+    }
+    break;
+  }
+
+  return {"OP_NULL", FLOW_NEXT};
+}
+
+std::string Label(unsigned int addr) {
+  char label[16];
+  std::snprintf(label, sizeof(label), "L_%03X", addr);
+  return label;
+}
+
+int main(int argc, const char **argv) {
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " <rom> <function> <out.cpp>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  const char *romFilename = argv[1];
+  std::string function = argv[2];
+
+  // load exactly like the interpreter so addresses line up
+  std::ifstream file(romFilename, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    std::cerr << "can't open " << romFilename << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+  unsigned int romSize = file.tellg();
+  if (romSize > MEMORY_SIZE - START_ADDRESS) {
+    romSize = MEMORY_SIZE - START_ADDRESS;
+  }
+  std::vector<std::uint8_t> memory(MEMORY_SIZE);
+  file.seekg(0, std::ios::beg);
+  file.read(reinterpret_cast<char *>(&memory[START_ADDRESS]), romSize);
+
+  unsigned int romEnd = START_ADDRESS + romSize;
+
+  // only translate instructions that sit wholly inside the rom
+  auto inRom = [&](unsigned int addr) {
+    return addr >= START_ADDRESS && addr + 2 <= romEnd;
+  };
+  auto opcodeAt = [&](unsigned int addr) -> std::uint16_t {
+    return (memory[addr] << 8u) | memory[addr + 1];
+  };
+
+  // walk everything statically reachable from the entry point
+  std::set<unsigned int> code;
+  std::vector<unsigned int> work = {START_ADDRESS};
+  while (!work.empty()) {
+    unsigned int addr = work.back();
+    work.pop_back();
+
+    if (!inRom(addr) || !code.insert(addr).second) {
+      continue;
+    }
+
+    std::uint16_t opcode = opcodeAt(addr);
+    unsigned int target = opcode & 0x0FFFu;
+
+    switch (Decode(opcode).flow) {
+    case FLOW_NEXT:
+      work.push_back(addr + 2);
+      break;
+    case FLOW_JUMP:
+      work.push_back(target);
+      break;
+    case FLOW_CALL:
+      work.push_back(target);
+      work.push_back(addr + 2);
+      break;
+    case FLOW_SKIP:
+      work.push_back(addr + 2);
+      work.push_back(addr + 4);
+      break;
+    case FLOW_WAIT:
+      work.push_back(addr + 2);
+      break;
+    case FLOW_DYNAMIC:
+      break;
+    }
+  }
+
+  if (code.empty()) {
+    std::cerr << romFilename << ": nothing to translate\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  // exactly which bytes we translated, so stores into data sitting between
+  // code don't count as self-modification; pages are the runtime's quick check
+  std::vector<std::uint8_t> codeMap(MEMORY_SIZE / 8);
+  std::uint16_t codePages = 0;
+  for (unsigned int addr : code) {
+    for (unsigned int byte = addr; byte < addr + 2; ++byte) {
+      codeMap[byte >> 3u] |= 1u << (byte & 7u);
+      codePages |= 1u << (byte >> 8u);
+    }
+  }
+
+  std::ofstream out(argv[3]);
+  if (!out.is_open()) {
+    std::cerr << "can't write " << argv[3] << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  // goto the label if we translated it, otherwise let the switch sort it out
+  auto go = [&](unsigned int addr) {
+    return code.count(addr) ? "goto " + Label(addr) + ";" : "goto dispatch;";
+  };
+
+  char hex[64];
+
+  out << "// generated by chip8-recomp from " << romFilename << "\n"
+      << "// " << code.size() << " instructions; do not edit\n\n"
+      << "#include \"recomp.h\"\n\n"
+      << "// translated bytes, one bit each\n"
+      << "static const std::uint8_t code[MEMORY_SIZE / 8] = {";
+
+  for (unsigned int i = 0; i < codeMap.size(); ++i) {
+    std::snprintf(hex, sizeof(hex), "0x%02X,", codeMap[i]);
+    out << (i % 12 == 0 ? "\n   " : "") << " " << hex;
+  }
+
+  out << "\n};\n\n"
+      << "static RecompExit Run(CHIP8 &core, unsigned long &budget) {\n"
+      << "dispatch:\n"
+      << "  switch (core.pc) {\n";
+
+  for (unsigned int addr : code) {
+    std::snprintf(hex, sizeof(hex), "0x%03X", addr);
+    out << "  case " << hex << ":\n    goto " << Label(addr) << ";\n";
+  }
+
+  out << "  default:\n"
+      << "    return RECOMP_INTERPRET;\n"
+      << "  }\n";
+
+  for (unsigned int addr : code) {
+    std::uint16_t opcode = opcodeAt(addr);
+    Decoded decoded = Decode(opcode);
+    unsigned int target = opcode & 0x0FFFu;
+
+    std::snprintf(hex, sizeof(hex), "0x%03X, 0x%04X", addr, opcode);
+    out << "\n" << Label(addr) << ":\n"
+        << "  RECOMP_STEP(" << hex << ");\n"
+        << "  core." << decoded.handler << "();\n"
+        << "  RECOMP_TIMERS();\n"
+        << "  RECOMP_CHECK_FAULT();\n";
+
+    // writes to memory might land on code we translated
+    std::uint8_t low = opcode & 0x00FFu;
+    if ((opcode & 0xF000u) == 0xF000u && (low == 0x33 || low == 0x55)) {
+      unsigned int length = low == 0x33 ? 3 : ((opcode & 0x0F00u) >> 8u) + 1;
+      out << "  RECOMP_CHECK_WRITE(" << length << ");\n";
+    }
+
+    switch (decoded.flow) {
+    case FLOW_NEXT:
+      out << "  " << go(addr + 2) << "\n";
+      break;
+    case FLOW_JUMP:
+    case FLOW_CALL:
+      out << "  " << go(target) << "\n";
+      break;
+    case FLOW_SKIP:
+      std::snprintf(hex, sizeof(hex), "0x%03X", addr + 4);
+      out << "  if (core.pc == " << hex << ") {\n"
+          << "    " << go(addr + 4) << "\n"
+          << "  }\n"
+          << "  " << go(addr + 2) << "\n";
+      break;
+    case FLOW_WAIT:
+      std::snprintf(hex, sizeof(hex), "0x%03X", addr);
+      out << "  if (core.pc == " << hex << ") {\n"
+          << "    " << go(addr) << "\n"
+          << "  }\n"
+          << "  " << go(addr + 2) << "\n";
+      break;
+    case FLOW_DYNAMIC:
+      out << "  goto dispatch;\n";
+      break;
+    }
+  }
+
+  std::snprintf(hex, sizeof(hex), "0x%04X", codePages);
+  out << "}\n\n"
+      << "extern const RecompProgram " << function << " = {Run, code, " << hex
+      << "};\n\n"
+      << "#ifdef CHIP8_RECOMP_VERIFY\n"
+      << "// standalone check against the interpreter: <rom> <cycles>\n"
+      << "#include <string>\n\n"
+      << "int main(int argc, const char **argv) {\n"
+      << "  if (argc != 3) {\n"
+      << "    return 2;\n"
+      << "  }\n"
+      << "  return RecompVerify(argv[1], " << function
+      << ", std::stoul(argv[2])) ? 0 : 1;\n"
+      << "}\n"
+      << "#endif\n";
+
+  std::cout << romFilename << ": " << code.size() << " instructions -> "
+            << argv[3] << "\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "recomp.h"
+
+// bytes the store the core just executed wrote from core.index on; only Fx33
+// and Fx55 store, and neither moves index
+static unsigned int StoreLength(std::uint16_t opcode) {
+  if ((opcode & 0xF0FFu) == 0xF033u) {
+    return 3;
+  }
+  if ((opcode & 0xF0FFu) == 0xF055u) {
+    return ((opcode & 0x0F00u) >> 8u) + 1;
+  }
+  return 0;
+}
+
+unsigned long RecompRun(CHIP8 &core, const RecompProgram &program,
+                        unsigned long budget, bool &modified) {
+  unsigned long left = budget;
+
+  while (left > 0) {
+    if (!modified) {
+      RecompExit exit = program.func(core, left);
+
+      if (exit == RECOMP_BUDGET || exit == RECOMP_FAULT) {
+        break;
+      }
+      if (exit == RECOMP_MODIFIED) {
+        modified = true;
+      }
+      if (left == 0) {
+        break;
+      }
+    }
+
+    // either untranslated pc or self-modified code; the interpreter can do it
+    // untranslated code can still store over translated code, so watch which
+    // pages it marks; keep the caller's marks for snapshots intact
+    std::uint16_t dirty = core.dirtyPages;
+    core.dirtyPages = 0;
+
+    core.Cycle();
+    --left;
+
+    if (!modified && (core.dirtyPages & program.codePages) &&
+        RecompTouchesCode(program.code, core.index,
+                          StoreLength(core.opcode))) {
+      modified = true;
+    }
+    core.dirtyPages |= dirty;
+
+    if (core.fault.type != FAULT_NONE) {
+      break;
+    }
+  }
+
+  return budget - left;
+}
+
+// the parts of the state a rom can observe
+static bool SameState(const CHIP8 &a, const CHIP8 &b) {
+  return std::memcmp(a.memory, b.memory, sizeof(a.memory)) == 0 &&
+         std::memcmp(a.registers, b.registers, sizeof(a.registers)) == 0 &&
+         std::memcmp(a.stack, b.stack, sizeof(a.stack)) == 0 &&
+         std::memcmp(a.video, b.video, sizeof(a.video)) == 0 &&
+         a.index == b.index && a.pc == b.pc && a.sp == b.sp &&
+         a.delayTimer == b.delayTimer && a.soundTimer == b.soundTimer &&
+         a.fault.type == b.fault.type;
+}
+
+bool RecompVerify(const char *romFilename, const RecompProgram &program,
+                  unsigned long cycles) {
+  // small chunks so a mismatch points close to where it started
+  const unsigned long chunk = 64;
+
+  CHIP8 reference;
+  CHIP8 translated;
+  reference.LoadROM(romFilename);
+  translated.LoadROM(romFilename);
+
+  bool modified = false;
+
+  // a fixed made up player, the same on both sides: every few chunks hold one
+  // key or nothing, so code behind Ex9E/ExA1/Fx0A gets compared too
+  const unsigned long holdChunks = 8;
+  std::mt19937 keyGen(0xC8);
+
+  for (unsigned long done = 0; done < cycles; done += chunk) {
+    if ((done / chunk) % holdChunks == 0) {
+      unsigned int held = keyGen() % 20; // 16 and up: nothing held
+      for (unsigned int key = 0; key < 16; ++key) {
+        reference.keypad[key] = key == held;
+        translated.keypad[key] = key == held;
+      }
+    }
+
+    for (unsigned long i = 0; i < chunk; ++i) {
+      reference.Cycle();
+    }
+    RecompRun(translated, program, chunk, modified);
+
+    if (!SameState(reference, translated)) {
+      std::cerr << romFilename << ": diverged within cycles " << done << "-"
+                << done + chunk << ", interpreter pc 0x" << std::hex
+                << reference.pc << " translated pc 0x" << translated.pc
+                << std::dec << "\n";
+      return false;
+    }
+
+    if (reference.fault.type != FAULT_NONE) {
+      break;
+    }
+  }
+
+  std::cout << romFilename << ": matches interpreter for " << cycles
+            << " cycles" << (modified ? " (fell back on self-modified code)" : "")
+            << "\n";
+  return true;
+}
@@ -0,0 +1,42 @@
+#include <cstring>
+
+#include "snapshot.h"
+
+void Snapshot::Save(CHIP8 &core) {
+  // take the whole thing once; from here on the core tracks its own writes
+  saved = core;
+  core.dirtyPages = 0;
+}
+
+void Snapshot::Restore(CHIP8 &core) const {
+  // copy back only the memory pages written to since the last restore
+  // a rom that never stores to memory costs us zero page copies
+  for (unsigned int page = 0; page < MEMORY_PAGES; ++page) {
+    if (core.dirtyPages & (1u << page)) {
+      std::memcpy(&core.memory[page * MEMORY_PAGE_SIZE],
+                  &saved.memory[page * MEMORY_PAGE_SIZE], MEMORY_PAGE_SIZE);
+    }
+  }
+  core.dirtyPages = 0;
+
+  // rest of the state is tiny; just copy it
+  std::memcpy(core.registers, saved.registers, sizeof(core.registers));
+  std::memcpy(core.stack, saved.stack, sizeof(core.stack));
+  std::memcpy(core.keypad, saved.keypad, sizeof(core.keypad));
+  std::memcpy(core.video, saved.video, sizeof(core.video));
+  std::memcpy(core.packedVideo, saved.packedVideo, sizeof(core.packedVideo));
+  core.dirtyRows = saved.dirtyRows;
+  core.videoHash = saved.videoHash;
+  core.index = saved.index;
+  core.pc = saved.pc;
+  core.sp = saved.sp;
+  core.delayTimer = saved.delayTimer;
+  core.soundTimer = saved.soundTimer;
+  core.opcode = saved.opcode;
+  core.fault = saved.fault;
+  core.unknownOpcodes = saved.unknownOpcodes;
+  core.lastUnknownOpcode = saved.lastUnknownOpcode;
+
+  // rng too, so Cxkk replays the same bytes every run
+  core.randGen = saved.randGen;
+}
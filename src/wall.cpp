@@ -0,0 +1,80 @@
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "wall.h"
+
+// how many torn reads before we give up on a slot this frame
+const unsigned int WALL_READ_RETRIES = 64;
+
+static std::string SegmentPath(const char *name) {
+  return std::string("/") + name;
+}
+
+WallSegment *WallOpen(const char *name) {
+  int fd = shm_open(SegmentPath(name).c_str(), O_CREAT | O_RDWR, 0600);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  // new segments come back zero filled; that's a valid empty wall
+  if (ftruncate(fd, sizeof(WallSegment)) != 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void *memory = mmap(nullptr, sizeof(WallSegment), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  return static_cast<WallSegment *>(memory);
+}
+
+void WallClose(WallSegment *segment) { munmap(segment, sizeof(WallSegment)); }
+
+void WallRemove(const char *name) { shm_unlink(SegmentPath(name).c_str()); }
+
+void WallPublish(WallSlot &slot, const std::uint8_t *packed) {
+  // only this process writes the slot, so a plain load is enough
+  std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (unsigned int i = 0; i < WALL_FRAME_WORDS; ++i) {
+    std::uint64_t word;
+    std::memcpy(&word, &packed[i * 8], 8);
+    slot.frame[i].store(word, std::memory_order_relaxed);
+  }
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool WallRead(const WallSlot &slot, std::uint8_t *packed,
+              std::uint32_t &sequence) {
+  for (unsigned int attempt = 0; attempt < WALL_READ_RETRIES; ++attempt) {
+    std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1u) {
+      continue;
+    }
+
+    for (unsigned int i = 0; i < WALL_FRAME_WORDS; ++i) {
+      std::uint64_t word = slot.frame[i].load(std::memory_order_relaxed);
+      std::memcpy(&packed[i * 8], &word, 8);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == before) {
+      sequence = before;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,123 @@
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "platform.h"
+#include "wall.h"
+
+// single window showing every worker's display side by side
+// all slots get composited into one atlas and uploaded as one texture, so the
+// cost is per presented frame no matter how many workers there are
+
+// a slot that hasn't published in this long is drawn as dead
+const auto WALL_STALE_TIME = std::chrono::seconds(1);
+
+const std::uint32_t LIVE_COLOR = 0xFFFFFFFF;
+const std::uint32_t DEAD_COLOR = 0x802020FF;
+
+int main(int argc, const char **argv) {
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <segment> <slots> <columns> <scale>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  const char *segmentName = argv[1];
+  unsigned int slots = std::stoi(argv[2]);
+  unsigned int columns = std::stoi(argv[3]);
+  int videoScale = std::stoi(argv[4]);
+
+  if (slots == 0 || slots > WALL_MAX_SLOTS || columns == 0) {
+    std::cerr << "need 1 to " << WALL_MAX_SLOTS << " slots\n";
+    std::exit(EXIT_FAILURE);
+  }
+  unsigned int rows = (slots + columns - 1) / columns;
+
+  WallSegment *segment = WallOpen(segmentName);
+  if (!segment) {
+    std::cerr << "can't map segment " << segmentName << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  unsigned int atlasWidth = columns * VIDEO_WIDTH;
+  unsigned int atlasHeight = rows * VIDEO_HEIGHT;
+
+  Platform platform("CHIP-8 Wall", atlasWidth * videoScale,
+                    atlasHeight * videoScale, atlasWidth, atlasHeight);
+
+  // everything the loop touches is allocated once up here
+  std::vector<std::uint32_t> atlas(atlasWidth * atlasHeight);
+  std::vector<std::uint32_t> lastSequence(slots, 0);
+  std::vector<std::chrono::steady_clock::time_point> lastChange(
+      slots, std::chrono::steady_clock::now());
+  std::vector<std::array<std::uint8_t, VIDEO_PACKED_SIZE>> lastFrame(slots);
+  std::array<std::uint8_t, VIDEO_PACKED_SIZE> frame;
+  std::uint8_t keypad[16] = {0};
+
+  int atlasPitch = sizeof(atlas[0]) * atlasWidth;
+
+  const auto frameTime = std::chrono::microseconds(1000000 / 60);
+  auto nextFrame = std::chrono::steady_clock::now();
+
+  bool quit = false;
+  while (!quit) {
+    quit = platform.ProcessInput(keypad);
+
+    // every worker gets the same keys
+    std::uint16_t keys = 0;
+    for (unsigned int i = 0; i < 16; ++i) {
+      keys |= (keypad[i] ? 1u : 0u) << i;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 0; i < slots; ++i) {
+      WallSlot &slot = segment->slots[i];
+      slot.keys.store(keys, std::memory_order_relaxed);
+
+      // liveness comes from the raw sequence, before and regardless of the
+      // read; a worker killed mid-publish leaves it odd forever and every
+      // read after that fails, but it still has to go dead
+      std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+      if (sequence != lastSequence[i]) {
+        lastSequence[i] = sequence;
+        lastChange[i] = now;
+      }
+      std::uint32_t color =
+          now - lastChange[i] > WALL_STALE_TIME ? DEAD_COLOR : LIVE_COLOR;
+
+      // torn read means the worker is mid-write; redraw last frame's pixels
+      // WallRead scribbles on its buffer even when it fails, so only a good
+      // read gets to replace them
+      if (WallRead(slot, frame.data(), sequence)) {
+        lastFrame[i] = frame;
+      }
+      const auto &packed = lastFrame[i];
+
+      // unpack into this slot's cell of the atlas
+      unsigned int cellX = (i % columns) * VIDEO_WIDTH;
+      unsigned int cellY = (i / columns) * VIDEO_HEIGHT;
+      for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y) {
+        std::uint32_t *row = &atlas[(cellY + y) * atlasWidth + cellX];
+        for (unsigned int x = 0; x < VIDEO_WIDTH; ++x) {
+          unsigned int bit = y * VIDEO_WIDTH + x;
+          row[x] = (packed[bit / 8] & (0x80u >> (bit % 8))) ? color : 0;
+        }
+      }
+    }
+
+    platform.Update(atlas.data(), atlasPitch);
+
+    nextFrame += frameTime;
+    std::this_thread::sleep_until(nextFrame);
+  }
+
+  // leave the segment in place; running workers still publish to it and a
+  // restarted viewer maps the same one. whoever launches the wall removes it
+  WallClose(segment);
+
+  return 0;
+}
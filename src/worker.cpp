@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "core.h"
+#include "wall.h"
+
+// one emulator with no window; publishes its display to a wall slot and
+// takes its keys from there
+
+int main(int argc, const char **argv) {
+  if (argc != 4) {
+    std::cerr << "Usage: " << argv[0] << " <segment> <slot> <rom>\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  const char *segmentName = argv[1];
+  unsigned int slotIndex = std::stoi(argv[2]);
+  const char *romFilename = argv[3];
+
+  if (slotIndex >= WALL_MAX_SLOTS) {
+    std::cerr << "slot must be below " << WALL_MAX_SLOTS << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  WallSegment *segment = WallOpen(segmentName);
+  if (!segment) {
+    std::cerr << "can't map segment " << segmentName << "\n";
+    std::exit(EXIT_FAILURE);
+  }
+  WallSlot &slot = segment->slots[slotIndex];
+
+  CHIP8 core;
+  core.LoadROM(romFilename);
+
+  // fixed 60hz; sleep_until keeps us from drifting
+  const auto frameTime = std::chrono::microseconds(1000000 / 60);
+  auto nextFrame = std::chrono::steady_clock::now();
+
+  while (core.fault.type == FAULT_NONE) {
+    std::uint16_t keys = slot.keys.load(std::memory_order_relaxed);
+    for (unsigned int i = 0; i < 16; ++i) {
+      core.keypad[i] = (keys >> i) & 1u;
+    }
+
+    for (unsigned int cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle) {
+      core.Cycle();
+    }
+
+    // packed cache is only refreshed by VideoHash(); cheap if nothing drew
+    core.VideoHash();
+    WallPublish(slot, core.packedVideo);
+
+    nextFrame += frameTime;
+    std::this_thread::sleep_until(nextFrame);
+  }
+
+  // leave the last frame up; the viewer will notice we stopped publishing
+  std::cerr << romFilename << ": " << FaultName(core.fault.type) << " at pc 0x"
+            << std::hex << core.fault.pc << "\n";
+
+  WallClose(segment);
+  return EXIT_FAILURE;
+}